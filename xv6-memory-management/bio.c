@@ -29,6 +29,7 @@
 struct {
   struct spinlock lock;
   struct buf buf[NBUF];
+  uchar data[NBUF][BSIZE];
 
   // Linked list of all buffers, through prev/next.
   // head.next is most recently used.
@@ -47,6 +48,7 @@ binit(void)
   bcache.head.prev = &bcache.head;
   bcache.head.next = &bcache.head;
   for(b = bcache.buf; b < bcache.buf+NBUF; b++){
+    b->data = bcache.data[b - bcache.buf];
     b->next = bcache.head.next;
     b->prev = &bcache.head;
     initsleeplock(&b->lock, "buffer");
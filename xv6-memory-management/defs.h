@@ -2,6 +2,16 @@ struct buf;
 struct context;
 struct file;
 struct inode;
+struct pageinfo;
+struct pageoutstats;
+struct zswapstats;
+struct ksmstats;
+struct tlbbatch;
+struct tlbstats;
+struct kallocstats;
+struct buddystats;
+struct kmemcache;
+struct slabstats;
 struct pipe;
 struct proc;
 struct rtcdate;
@@ -52,14 +62,23 @@ struct inode*   nameiparent(char*, char*);
 int             readi(struct inode*, char*, uint, uint);
 void            stati(struct inode*, struct stat*);
 int             writei(struct inode*, char*, uint, uint);
-int             createSwapFile(struct proc* p);
-int             readFromSwapFile(struct proc * p, char* buffer, uint placeOnFile, uint size);
-int             writeToSwapFile(struct proc* p, char* buffer, uint placeOnFile, uint size);
-int             removeSwapFile(struct proc* p);
-void            copyContentsOfSwapFile(struct proc* parent, struct proc* child);
-int             nextFreePageIndexInSwapFile(struct proc *p);
-int             fetchSwapPageToPhysicalPage(struct proc* p, int physicalPageIdx, uint vAddr, char* buffer);
-int             fetchPhysicalPageToSwapPage(struct proc* p, int physicalPageIdx, uint vAddr);
+void            swapinit(void);
+int             readSwapSlots(int firstSlot, char **pages, int n);
+int             writeSwapSlots(int firstSlot, char **pages, int n);
+bool            isSwapSlotUsed(int slot);
+int             nextFreeRunInSwapArea(int n);
+int             allocSwapSlots(int n);
+int             allocSwapSlot(void);
+void            dupSwapSlot(int slot);
+void            releaseSwapSlot(int slot);
+int             getSwapSlotRefCount(int slot);
+int             getNoOfUsedSwapSlots(void);
+void            removePageFromSwapFile(struct proc *p, uint vAddr);
+int             fetchSwapPagesToPhysicalPages(struct proc* p, uint vAddr, char** frames, int n);
+int             writePageToSwapSlot(struct proc* p, uint vAddr, char* pageContent);
+int             fetchPhysicalPagesToSwapPages(struct proc* p, uint* vAddrs, char** frames, int n);
+void            dropSwapCache(struct proc *p);
+int             fetchPhysicalPageToSwapPage(struct proc* p, uint vAddr, char* pageContent);
 int             getIndexOfPageInSwapFile(struct proc *p, uint vAddr);
 
 
@@ -67,6 +86,7 @@ int             getIndexOfPageInSwapFile(struct proc *p, uint vAddr);
 void            ideinit(void);
 void            ideintr(void);
 void            iderw(struct buf*);
+void            iderwv(struct buf*, int);
 
 // ioapic.c
 void            ioapicenable(int irq, int cpu);
@@ -78,6 +98,16 @@ char*           kalloc(void);
 void            kfree(char*);
 void            kinit1(void*, void*);
 void            kinit2(void*, void*);
+uint            getNoOfFreePages(void);
+void            getKallocStats(struct kallocstats*);
+char*           kallocPages(int);
+void            kfreePages(char*, int);
+void            getBuddyStats(struct buddystats*);
+void            incFrameRefCount(char*);
+int             getFrameRefCount(char*);
+void            setFrameOwner(char*, struct proc*, uint);
+void            clearFrameOwner(char*);
+char*           nextFrameOfGlobalClock(struct proc**, uint*);
 
 // kbd.c
 void            kbdintr(void);
@@ -89,6 +119,7 @@ extern volatile uint*    lapic;
 void            lapiceoi(void);
 void            lapicinit(void);
 void            lapicstartap(uchar, uint);
+void            lapicipi(uchar, int);
 void            microdelay(int);
 
 // log.c
@@ -106,6 +137,7 @@ void            picenable(int);
 void            picinit(void);
 
 // pipe.c
+void            pipeinit(void);
 int             pipealloc(struct file**, struct file**);
 void            pipeclose(struct pipe*, int);
 int             piperead(struct pipe*, char*, int);
@@ -131,14 +163,27 @@ int             wait(void);
 void            wakeup(void*);
 void            yield(void);
 void            removeInfoOfAllPages(struct proc* p);
+void            acquirePagingLock(struct proc *p);
+bool            tryAcquirePagingLock(struct proc *p);
+void            releasePagingLock(struct proc *p);
+void            kswapdinit(void);
+void            wakeupkswapd(void);
+void            ksmdinit(void);
+void            scanSamePages(int n);
+bool            acquireProcTableIfIdle(struct proc *p, struct proc *q);
+void            releaseProcTable(void);
+void            freeUserPgdir(pde_t*);
+
+// slab.c
+void            slabinit(void);
+struct kmemcache* kmemCacheCreate(char*, uint);
+void*           kmemCacheAlloc(struct kmemcache*);
+void            kmemCacheFree(struct kmemcache*, void*);
+int             getSlabStats(int, struct slabstats*);
 
 // swtch.S
 void            swtch(struct context**, struct context*);
 
-// sysfile
-struct inode*   create(char *path, short type, short major, short minor);
-int             isdirempty(struct inode *dp);
-
 
 // spinlock.c
 void            acquire(struct spinlock*);
@@ -199,21 +244,80 @@ int             loaduvm(pde_t*, char*, struct inode*, uint, uint);
 pde_t*          copyuvm(pde_t*, uint);
 void            switchuvm(struct proc*);
 void            switchkvm(void);
+void            pgeinit(void);
 int             copyout(pde_t*, uint, void*, uint);
 void            clearpteu(pde_t *pgdir, char *uva);
-int             fifo_getIndexOfNewPhysicalPage(struct proc *p);
-int             insertPageToPhysicalMemory(struct proc *p, uint vAddr, bool isMemoryFull);
-void            removePageFromPhysicalMemory(struct proc *p, int index, bool isPageFault);
+struct pageinfo* getPageInfoOfVpn(struct proc *p, uint vpn);
+struct pageinfo* getPageInfo(struct proc *p, uint vAddr);
+struct pageinfo* allocPageInfo(struct proc *p, uint vAddr);
+void            freePageInfo(struct proc *p);
+int             copyPageInfo(struct proc *parent, struct proc *child);
+bool            isPageResident(struct proc *p, uint vAddr);
+bool            isPhysicalMemoryFull(struct proc *p);
+int             insertPageToPhysicalMemory(struct proc *p, uint vAddr);
+void            removePageFromPhysicalMemory(struct proc *p, uint vAddr);
 void            updatePteFlags(struct proc* p, uint vAddr, uint pAddr, bool isPageout);
-int             getIndexOfPhysicalPage(struct proc *p, uint vAddr);
-void            pageOutToSwapFile(struct proc *p);
+int             fifo_getPageToBeSwappedOut(struct proc *p);
+int             clock_getPageToBeSwappedOut(struct proc *p);
+int             aging_getPageToBeSwappedOut(struct proc *p);
+int             wsclock_getPageToBeSwappedOut(struct proc *p);
+void            writeBackPage(struct proc *p, uint vAddr);
+int             selectPageToBeSwappedOut(struct proc *p);
+int             pageOutToSwapFile(struct proc *p);
+int             pageOutBatchToSwapFile(struct proc *p, int n);
+char*           unmapPage(struct proc *p, uint vAddr);
+void            remapPage(struct proc *p, uint vAddr, char *frame);
+int             evictPage(struct proc *p, uint vAddr);
+int             global_pageOutToSwapFile(struct proc *curproc);
+extern struct tlbstats tlbStats;
+void            tlbShootdownInterrupt(void);
+void            flushTlb(pde_t *pgdir, uint *vAddrs, int n);
+void            flushTlbPage(pde_t *pgdir, uint vAddr);
+void            addToTlbBatch(struct tlbbatch *batch, uint vAddr);
+void            endTlbBatch(struct tlbbatch *batch);
+extern int      globalReplacement;
+extern struct pageoutstats pageOutStats;
+bool            isFreeMemoryLow(void);
+int             getNoOfReadAheadPages(struct proc *p, uint vAddr);
+int             balanceFreeFrames(void);
 bool            pageInToPhysicalMemory(struct proc *p, uint vAddr);
 bool            isPageWrittable(struct proc *p, void* vAddr);
+int             reserveuvm(struct proc *p, uint oldsz, uint newsz);
+bool            isPageReserved(pde_t *pgdir, uint vAddr);
+int             readImagePage(struct proc *p, uint vAddr, char *mem);
+bool            demandPage(struct proc *p, uint vAddr);
+bool            handlePageFault(struct proc *p, uint vAddr);
+int             pinUserRange(struct proc *p, uint vAddr, uint size);
+void            unpinUserRanges(struct proc *p);
+bool            isPagePinned(struct proc *p, uint vpn);
+extern char*    zeroFrame;
+void            zeroframeinit(void);
+void            pageinfoinit(void);
+bool            isZeroFilled(char *frame);
+bool            isZeroPage(struct proc *p, uint vAddr);
+bool            mapZeroFrame(struct proc *p, uint vAddr);
+extern int      ksmPagesToScan;
+extern int      ksmSleepTicks;
+extern struct ksmstats ksmStats;
+uint            pageChecksum(char *frame);
+void            mergeSamePage(struct proc *p, uint vAddr);
+bool            isCopyOnWritePage(pde_t *pgdir, uint vAddr);
+int             copyOnWrite(pde_t *pgdir, uint vAddr);
 bool            isPageMovedToSwapFile(struct proc *p, void* vAddr);
 bool            updateWritePermission(struct proc *p, void* vAddr);
-int             nru_getIndexOfPageToBeSwappedOut(struct proc *p);
+int             nru_getPageToBeSwappedOut(struct proc *p);
 void            printProcPages(struct proc *p);
+void            resetReplacementState(struct proc *p);
 void            resetAccessBit(struct proc *p);
+void            updatePageAges(struct proc *p);
+
+// zswap.c
+void            zswapinit(void);
+int             zswapStore(int slot, char *page);
+int             zswapLoad(int slot, char *page);
+void            zswapInvalidate(int slot);
+int             zswapOldestSlot(void);
+extern struct zswapstats zswapStats;
 
 // number of elements in fixed-size array
 #define NELEM(x) (sizeof(x)/sizeof((x)[0]))
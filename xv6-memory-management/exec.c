@@ -18,6 +18,9 @@ exec(char *path, char **argv)
   struct proghdr ph;
   pde_t *pgdir, *oldpgdir;
   struct proc *curproc = myproc();
+  struct inode *image, *oldimage;
+  struct imagesegment segs[MAX_IMAGE_SEGMENTS];
+  int nsegs;
 
   begin_op();
 
@@ -28,6 +31,7 @@ exec(char *path, char **argv)
   }
   ilock(ip);
   pgdir = 0;
+  image = 0;
   // Check ELF header
   if(readi(ip, (char*)&elf, 0, sizeof(elf)) != sizeof(elf))
     goto bad;
@@ -39,6 +43,7 @@ exec(char *path, char **argv)
 
   // Load program into memory.
   sz = 0;
+  nsegs = 0;
   for(i=0, off=elf.phoff; i<elf.phnum; i++, off+=sizeof(ph)){
     if(readi(ip, (char*)&ph, off, sizeof(ph)) != sizeof(ph))
       goto bad;
@@ -48,15 +53,29 @@ exec(char *path, char **argv)
       goto bad;
     if(ph.vaddr + ph.memsz < ph.vaddr)
       goto bad;
-    if((sz = allocuvm(pgdir, sz, ph.vaddr + ph.memsz)) == 0)
+
+    /*------------------------- my changes starts -----------------------------*/
+
+    // the segment is only reserved, demandPage() reads its pages from the
+    // executable when they are first touched
+    if((sz = reserveuvm(curproc, sz, ph.vaddr + ph.memsz)) == 0)
       goto bad;
     if(ph.vaddr % PGSIZE != 0)
       goto bad;
-    if(loaduvm(pgdir, (char*)ph.vaddr, ip, ph.off, ph.filesz) < 0)
+    if(nsegs == MAX_IMAGE_SEGMENTS)
       goto bad;
+    segs[nsegs].vaddr = ph.vaddr;
+    segs[nsegs].memsz = ph.memsz;
+    segs[nsegs].filesz = ph.filesz;
+    segs[nsegs].off = ph.off;
+    nsegs++;
+
+    /*------------------------- my changes ends -----------------------------*/
   }
-  iunlockput(ip);
+  // the process keeps a reference to the executable
+  iunlock(ip);
   end_op();
+  image = ip;
   ip = 0;
 
   // Allocate two pages at the next page boundary.
@@ -92,14 +111,57 @@ exec(char *path, char **argv)
       last = s+1;
   safestrcpy(curproc->name, last, sizeof(curproc->name));
 
+  /*------------------------- my changes starts -----------------------------*/
+
+  // the paging meta-data describes the old image; the new one is tracked as
+  // its pages are faulted in
+  if(curproc->pid > 2){
+    acquirePagingLock(curproc);
+    removeInfoOfAllPages(curproc);
+  }
+
+  /*------------------------- my changes ends -----------------------------*/
+
   // Commit to the user image.
   oldpgdir = curproc->pgdir;
   curproc->pgdir = pgdir;
   curproc->sz = sz;
   curproc->tf->eip = elf.entry;  // main
   curproc->tf->esp = sp;
+
+  /*------------------------- my changes starts -----------------------------*/
+  oldimage = curproc->image;
+  curproc->image = image;
+  curproc->noOfImageSegments = nsegs;
+  memmove(curproc->imageSegments, segs, sizeof(segs));
+  /*------------------------- my changes ends -----------------------------*/
+
   switchuvm(curproc);
-  freevm(oldpgdir);
+
+  /*------------------------- my changes starts -----------------------------*/
+  if(curproc->pid > 2){
+    // only the stack is resident yet
+    for(i = 0; i < sz; i += PGSIZE){
+      if(!isPageReserved(pgdir, i)){
+        insertPageToPhysicalMemory(curproc, i);
+      }
+    }
+
+    releasePagingLock(curproc);
+  }
+
+  // another cpu may still have it loaded
+  freeUserPgdir(oldpgdir);
+  /*------------------------- my changes ends -----------------------------*/
+
+  /*------------------------- my changes starts -----------------------------*/
+  if(oldimage){
+    begin_op();
+    iput(oldimage);
+    end_op();
+  }
+  /*------------------------- my changes ends -----------------------------*/
+
   return 0;
 
  bad:
@@ -109,5 +171,10 @@ exec(char *path, char **argv)
     iunlockput(ip);
     end_op();
   }
+  if(image){
+    begin_op();
+    iput(image);
+    end_op();
+  }
   return -1;
 }
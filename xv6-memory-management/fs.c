@@ -180,9 +180,9 @@ iinit(int dev)
 
   readsb(dev, &sb);
   cprintf("sb: size %d nblocks %d ninodes %d nlog %d logstart %d\
- inodestart %d bmap start %d\n", sb.size, sb.nblocks,
+ inodestart %d bmap start %d swap start %d nswap %d\n", sb.size, sb.nblocks,
           sb.ninodes, sb.nlog, sb.logstart, sb.inodestart,
-          sb.bmapstart);
+          sb.bmapstart, sb.swapstart, sb.nswap);
 }
 
 static struct inode* iget(uint dev, uint inum);
@@ -669,248 +669,409 @@ nameiparent(char *path, char *name)
   return namex(path, 1, name);
 }
 
-// NEW FOR PAGING
+/*------------------------- my changes starts -----------------------------*/
 
-#include "fcntl.h"
-#define DIGITS 14
+// Raw swap area: the SWAPSIZE blocks that mkfs leaves after the file
+// system (sb.swapstart). Swap I/O goes to it with iderw(), so it is neither
+// logged nor cached in bcache, and only after zswap.c, which keeps the
+// pages it can compress in memory. A slot holds one page; it is shared by
+// reference by the processes forked from the one that wrote it, and it is
+// only freed when no page refers to it any more.
+#define BLOCKS_PER_SLOT (PGSIZE / BSIZE)
+// pages moved by one swaprw(), a fault with its read-ahead
+#define SWAP_RW_MAX (SWAP_READAHEAD_MAX + 1)
 
-char* itoa(int i, char b[]){
-    char const digit[] = "0123456789";
-    char* p = b;
-    if(i<0){
-        *p++ = '-';
-        i *= -1;
-    }
-    int shifter = i;
-    do{ //Move to where representation ends
-        ++p;
-        shifter = shifter/10;
-    }while(shifter);
-    *p = '\0';
-    do{ //Move back, inserting digits as u go
-        *--p = digit[i%10];
-        i = i/10;
-    }while(i);
-    return b;
-}
+struct {
+  struct spinlock lock;
+  uint bitmap[MAX_SWAP_SLOTS / 32];  // a set bit means the slot is used
+  uchar refs[MAX_SWAP_SLOTS];        // pages referring to each slot
+  struct sleeplock writeLock;        // one writer, so a page written back
+                                     // from zswap cannot race a new one
+  char writeBackPage[PGSIZE];        // page being written back from zswap
+} swaparea;
 
-//remove swap file of proc p;
-int
-removeSwapFile(struct proc* p)
+void
+swapinit(void)
 {
-	//path of proccess
-	char path[DIGITS];
-	memmove(path,"/.swap", 6);
-	itoa(p->pid, path+ 6);
-
-	struct inode *ip, *dp;
-	struct dirent de;
-	char name[DIRSIZ];
-	uint off;
-
-	if(0 == p->swapFile)
-	{
-		return -1;
-	}
-	fileclose(p->swapFile);
+  initlock(&swaparea.lock, "swaparea");
+  initsleeplock(&swaparea.writeLock, "swapwrite");
+}
 
-	begin_op();
-	if((dp = nameiparent(path, name)) == 0)
-	{
-		end_op();
-		return -1;
-	}
+// number of slots, known once iinit() has read the superblock
+static int
+noOfSwapSlots(void)
+{
+  if(sb.nswap / BLOCKS_PER_SLOT < MAX_SWAP_SLOTS)
+    return sb.nswap / BLOCKS_PER_SLOT;
+  return MAX_SWAP_SLOTS;
+}
 
-	ilock(dp);
+// Set up b to move a page between memory and its slot on disk. The disk
+// reads or writes the frame itself. The buf is private to the caller and
+// never enters bcache.
+static void
+swapbufinit(struct buf *b, int slot, char *page, int write)
+{
+  memset(b, 0, sizeof(*b));
+  initsleeplock(&b->lock, "swapbuf");
+  acquiresleep(&b->lock);
+  b->dev = ROOTDEV;
+  b->blockno = sb.swapstart + slot * BLOCKS_PER_SLOT;
+  b->data = (uchar*)page;
+  b->flags = write ? (B_PAGE | B_DIRTY) : B_PAGE;
+}
 
-	  // Cannot unlink "." or "..".
-	if(namecmp(name, ".") == 0 || namecmp(name, "..") == 0)
-	   goto bad;
+// Move a page between memory and its slot on disk with one iderw().
+static void
+swapdiskrw(int slot, char *page, int write)
+{
+  struct buf b;
 
-	if((ip = dirlookup(dp, name, &off)) == 0)
-		goto bad;
-	ilock(ip);
+  swapbufinit(&b, slot, page, write);
+  iderw(&b);
+  releasesleep(&b.lock);
+}
 
-	if(ip->nlink < 1)
-		panic("unlink: nlink < 1");
-	if(ip->type == T_DIR && !isdirempty(ip)){
-		iunlockput(ip);
-		goto bad;
-	}
+// Write the oldest page of the compressed pool to its slot on disk to
+// make room in the pool, -1 if the pool is empty. The caller holds
+// swaparea.writeLock, so the slot cannot be rewritten meanwhile; the page
+// stays in the pool until it is on disk, for faults that read it.
+static int
+writeBackOldestSwapPage(void)
+{
+  int slot = zswapOldestSlot();
 
-	memset(&de, 0, sizeof(de));
-	if(writei(dp, (char*)&de, off, sizeof(de)) != sizeof(de))
-		panic("unlink: writei");
-	if(ip->type == T_DIR){
-		dp->nlink--;
-		iupdate(dp);
-	}
-	iunlockput(dp);
+  if(slot == -1)
+    return -1;
 
-	ip->nlink--;
-	iupdate(ip);
-	iunlockput(ip);
+  if(zswapLoad(slot, swaparea.writeBackPage) == 0){
+    swapdiskrw(slot, swaparea.writeBackPage, 1);
+    zswapInvalidate(slot);
+    zswapStats.writeBacks++;
+  }
 
-	end_op();
+  return 0;
+}
 
-	return 0;
+// Keep the page of slot compressed in memory. Returns -1 if it has to be
+// written to disk, because it does not compress or the pool stays full
+// after writing back its oldest pages. The caller holds
+// swaparea.writeLock.
+static int
+storeSwapPage(int slot, char *page)
+{
+  int stored = zswapStore(slot, page);
 
-	bad:
-		iunlockput(dp);
-		end_op();
-		return -1;
+  for(int i = 0; stored == -2 && i < ZSWAP_MAX_WRITEBACKS; i++){
+    if(writeBackOldestSwapPage() == -1)
+      break;
+    stored = zswapStore(slot, page);
+  }
 
+  return stored == 0 ? 0 : -1;
 }
 
-
-//return 0 on success
-int
-createSwapFile(struct proc* p)
+// Move n pages between memory and the slots from firstSlot on. A page is
+// read from the compressed pool when the pool holds it, from disk otherwise.
+// The pages that go to or come from disk are queued together with
+// iderwv().
+static int
+swaprw(int firstSlot, char **pages, int n, int write)
 {
+  struct buf bufs[SWAP_RW_MAX];
+  int queued = 0;
 
-	char path[DIGITS];
-	memmove(path,"/.swap", 6);
-	itoa(p->pid, path+ 6);
+  if(firstSlot < 0 || firstSlot + n > noOfSwapSlots() || n > SWAP_RW_MAX)
+    return -1;
 
-    begin_op();
-    struct inode * in = create(path, T_FILE, 0, 0);
-	iunlock(in);
+  if(write)
+    acquiresleep(&swaparea.writeLock);
 
-	p->swapFile = filealloc();
-	if (p->swapFile == 0)
-		panic("no slot for files on /store");
+  for(int i = 0; i < n; i++){
+    if(write && storeSwapPage(firstSlot + i, pages[i]) == 0)
+      continue;
+    if(!write && zswapLoad(firstSlot + i, pages[i]) == 0){
+      zswapStats.loads++;
+      continue;
+    }
 
-	p->swapFile->ip = in;
-	p->swapFile->type = FD_INODE;
-	p->swapFile->off = 0;
-	p->swapFile->readable = O_WRONLY;
-	p->swapFile->writable = O_RDWR;
-    end_op();
+    swapbufinit(&bufs[queued++], firstSlot + i, pages[i], write);
+  }
 
-    return 0;
+  iderwv(bufs, queued);
+  for(int i = 0; i < queued; i++)
+    releasesleep(&bufs[i].lock);
+
+  if(write)
+    releasesleep(&swaparea.writeLock);
+
+  return n * PGSIZE;
 }
 
-//return as sys_write (-1 when error)
 int
-writeToSwapFile(struct proc * p, char* buffer, uint placeOnFile, uint size)
+readSwapSlots(int firstSlot, char **pages, int n)
 {
-	p->swapFile->off = placeOnFile;
-
-	return filewrite(p->swapFile, buffer, size);
-
+  return swaprw(firstSlot, pages, n, 0);
 }
 
-//return as sys_read (-1 when error)
 int
-readFromSwapFile(struct proc * p, char* buffer, uint placeOnFile, uint size)
+writeSwapSlots(int firstSlot, char **pages, int n)
 {
-	p->swapFile->off = placeOnFile;
+  return swaprw(firstSlot, pages, n, 1);
+}
 
-	return fileread(p->swapFile, buffer,  size);
+bool isSwapSlotUsed(int slot){
+  return (swaparea.bitmap[slot / 32] & (1 << (slot % 32))) != 0;
 }
 
+// first slot of a run of n free slots, -1 if there is none.
+// The caller holds swaparea.lock.
+int nextFreeRunInSwapArea(int n) {
+  int run = 0;
 
-/*------------------------- my changes starts -----------------------------*/
-
-void copyContentsOfSwapFile(struct proc* parent, struct proc* child){
-  char buffer[PGSIZE];
+  for (int slot=0; slot < noOfSwapSlots(); slot++) {
+    // a whole word of the bitmap is skipped when all of its slots are used
+    if (slot % 32 == 0 && swaparea.bitmap[slot / 32] == ~0U){
+      run = 0;
+      slot += 31;
+      continue;
+    }
 
-  for (int i=0; i < MAX_SWAPFILE_PAGES; i++){
+    if (isSwapSlotUsed(slot)){
+      run = 0;
+    }
+    else if (++run == n){
+      return slot - n + 1;
+    }
+  }
 
-    if ((int) parent->swapFilePages[i] != -1){
-      int read = readFromSwapFile(parent, buffer, i * PGSIZE, PGSIZE);
+  return -1;
+}
 
-      if (read != PGSIZE){
-        panic("copyContentsOfSwapFile: readFromSwapFile(error)");
-      }
-      
-      int write = writeToSwapFile(child, buffer, i * PGSIZE, PGSIZE);
-      if (write != PGSIZE){
-        cprintf("write=%d, %d\n", write, i);
-        panic("copyContentsOfSwapFile: writeToSwapFile(error)");
-      }
+// take a run of n free slots with one reference each, returns the first
+// slot or -1 if the swap area has no such run
+int allocSwapSlots(int n){
+  int first;
+
+  acquire(&swaparea.lock);
+  first = nextFreeRunInSwapArea(n);
+  if(first != -1){
+    for(int slot = first; slot < first + n; slot++){
+      swaparea.bitmap[slot / 32] |= 1 << (slot % 32);
+      swaparea.refs[slot] = 1;
     }
   }
+  release(&swaparea.lock);
+
+  return first;
 }
 
-int nextFreePageIndexInSwapFile(struct proc *p) {
-  
-  for (int i=0; i < MAX_SWAPFILE_PAGES; i++) {
-    if ((int) p->swapFilePages[i] < 0){
-      return i;
-    }
+// take a free slot with one reference, -1 if the swap area is full
+int allocSwapSlot(void){
+  return allocSwapSlots(1);
+}
+
+void dupSwapSlot(int slot){
+  acquire(&swaparea.lock);
+  swaparea.refs[slot]++;
+  release(&swaparea.lock);
+}
+
+void releaseSwapSlot(int slot){
+  acquire(&swaparea.lock);
+  if(swaparea.refs[slot] <= 1){
+    swaparea.refs[slot] = 0;
+    swaparea.bitmap[slot / 32] &= ~(1 << (slot % 32));
+    // before the slot can be taken again
+    zswapInvalidate(slot);
+  } else {
+    swaparea.refs[slot]--;
   }
+  release(&swaparea.lock);
+}
 
-  return -1;
+int getSwapSlotRefCount(int slot){
+  return swaparea.refs[slot];
 }
 
-int fetchSwapPageToPhysicalPage(struct proc* p, int physicalPageIdx, uint vAddr, char* buffer){
-    for (int i=0; i < MAX_SWAPFILE_PAGES; i++){
-      if(p->swapFilePages[i] == vAddr){
-          int read = readFromSwapFile(p, buffer, i * PGSIZE, PGSIZE);
+// slots of the swap area in use
+int getNoOfUsedSwapSlots(void){
+  int n = 0;
 
-          if(read != -1){
-              p->physicalPages[physicalPageIdx] = p->swapFilePages[i];
-              p->noOfSwapFilePages--;
-              p->swapFilePages[i] = -2;
-          }
+  acquire(&swaparea.lock);
+  for(int slot = 0; slot < noOfSwapSlots(); slot++){
+    if(isSwapSlotUsed(slot))
+      n++;
+  }
+  release(&swaparea.lock);
 
-          return read;
-      }
+  return n;
+}
+
+// drop the copy of the page kept in the swap area, if there is one
+void removePageFromSwapFile(struct proc *p, uint vAddr){
+    struct pageinfo *page = getPageInfo(p, vAddr);
+
+    // a zero page has no slot to drop, it is forgotten like a swapped one
+    if(page != 0 && page->state == PAGE_ZERO){
+      page->state = PAGE_UNUSED;
     }
 
-    // page with vAddr is not found in swapFile
-    return -1;
+    if(page == 0 || page->swapSlot == -1){
+      return;
+    }
+
+    releaseSwapSlot(page->swapSlot);
+    p->noOfSwapFilePages--;
+    page->swapSlot = -1;
+
+    if(page->state == PAGE_SWAPPED){
+      page->state = PAGE_UNUSED;
+    }
 }
 
-int fetchPhysicalPageToSwapPage(struct proc* p, int physicalPageIdx, uint vAddr){
-    int index = nextFreePageIndexInSwapFile(p);
+// Read the page at vAddr and the n - 1 pages after it, which sit in the
+// slots following its slot, straight into their frames. The slots are kept
+// as a swap cache: until a page is written (PTE_D) it is dropped on
+// eviction instead of being written again. Returns the number of pages
+// read, -1 if vAddr has no slot.
+int fetchSwapPagesToPhysicalPages(struct proc* p, uint vAddr, char** frames, int n){
+    int index = getIndexOfPageInSwapFile(p, vAddr);
 
     if(index == -1){
-      panic("fetchPhysicalPageToSwapPage: index(error)");
+      // page with vAddr is not found in the swap area
       return -1;
     }
 
-    int write = writeToSwapFile(p, (char*) vAddr, index * PGSIZE, PGSIZE);
-
-    if(write != -1){
-        p->swapFilePages[index] = vAddr;
-        p->noOfSwapFilePages++;
+    if(readSwapSlots(index, frames, n) == -1){
+      return -1;
     }
 
-    return write;
+    return n;
 }
 
+// write the page into its swap slot, a slot is allocated if it has none.
+// The state of the page is not changed, so a resident page keeps running
+// with a clean copy in its swap slot.
+int writePageToSwapSlot(struct proc* p, uint vAddr, char* pageContent){
+    struct pageinfo *page = getPageInfo(p, vAddr);
+    int index = page ? page->swapSlot : -1;
+
+    // a slot shared with a forked process still holds its page
+    if(index != -1 && getSwapSlotRefCount(index) > 1){
+      releaseSwapSlot(index);
+      p->noOfSwapFilePages--;
+      page->swapSlot = index = -1;
+    }
 
-int getIndexOfPageInSwapFile(struct proc *p, uint vAddr){
-    for (int i=0; i < MAX_SWAPFILE_PAGES; i++){
-        if(p->swapFilePages[i] == vAddr){
-            return i;
-        }
+    if(page != 0 && index == -1){
+      index = allocSwapSlot();
+    }
+    if(page != 0 && index == -1){
+      dropSwapCache(p);
+      index = allocSwapSlot();
     }
 
-    return -1; 
-}
+    // the swap area is full, the caller keeps the page resident
+    if(page == 0 || index == -1){
+      return -1;
+    }
 
+    int write = writeSwapSlots(index, &pageContent, 1);
 
-/*------------------------- my changes ends -----------------------------*/
+    if(write == -1 && page->swapSlot == -1){
+        releaseSwapSlot(index);
+    }
+    else if(write != -1 && page->swapSlot == -1){
+        p->noOfSwapFilePages++;
+        page->swapSlot = index;
+    }
 
+    // the page now differs from the executable, the swap slot holds it
+    if(write != -1){
+        page->isImagePage = 0;
+    }
 
+    return write;
+}
+
+// Write n pages of p, whose frames evictPage() has unmapped, to a run of
+// consecutive slots with a single writeSwapSlots(). The pages give up
+// their old slots for the run. Without a free run, each page is written
+// on its own.
+int fetchPhysicalPagesToSwapPages(struct proc* p, uint* vAddrs, char** frames, int n){
+    int first, result = 0;
 
+    for(int i = 0; i < n; i++){
+      removePageFromSwapFile(p, vAddrs[i]);
+    }
 
+    if((first = allocSwapSlots(n)) == -1){
+      dropSwapCache(p);
+      first = allocSwapSlots(n);
+    }
 
+    if(first == -1){
+      for(int i = 0; i < n; i++){
+        if(fetchPhysicalPageToSwapPage(p, vAddrs[i], frames[i]) == -1){
+          result = -1;
+        }
+      }
+      return result;
+    }
 
+    if(writeSwapSlots(first, frames, n) == -1){
+      for(int i = 0; i < n; i++){
+        releaseSwapSlot(first + i);
+      }
+      return -1;
+    }
 
+    for(int i = 0; i < n; i++){
+      struct pageinfo *page = getPageInfo(p, vAddrs[i]);
 
+      page->swapSlot = first + i;
+      page->state = PAGE_SWAPPED;
+      page->isImagePage = 0;
+      p->noOfSwapFilePages++;
+    }
 
+    return 0;
+}
 
+// give up the swap cache of p, the slots of its resident pages, to make
+// room in the swap area
+void dropSwapCache(struct proc *p){
+    for(uint va = 0; va < p->sz; va += PGSIZE){
+      struct pageinfo *page = getPageInfo(p, va);
 
+      if(page != 0 && page->state == PAGE_RESIDENT && page->swapSlot != -1){
+        removePageFromSwapFile(p, va);
+      }
+    }
+}
 
+int fetchPhysicalPageToSwapPage(struct proc* p, uint vAddr, char* pageContent){
+    int write = writePageToSwapSlot(p, vAddr, pageContent);
 
+    if(write != -1){
+        getPageInfo(p, vAddr)->state = PAGE_SWAPPED;
+    }
 
+    return write;
+}
 
 
+// slot of the copy of the page in the swap area, -1 if it has none
+int getIndexOfPageInSwapFile(struct proc *p, uint vAddr){
+    struct pageinfo *page = getPageInfo(p, vAddr);
 
+    if(page == 0){
+        return -1;
+    }
 
+    return page->swapSlot; 
+}
 
 
+/*------------------------- my changes ends -----------------------------*/
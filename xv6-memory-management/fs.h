@@ -19,6 +19,8 @@ struct superblock {
   uint logstart;     // Block number of first log block
   uint inodestart;   // Block number of first inode block
   uint bmapstart;    // Block number of first free map block
+  uint swapstart;    // Block number of first block of the raw swap area
+  uint nswap;        // Number of blocks of the raw swap area
 };
 
 #define NDIRECT 12
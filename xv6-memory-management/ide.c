@@ -23,6 +23,10 @@
 #define IDE_CMD_WRITE 0x30
 #define IDE_CMD_RDMUL 0xc4
 #define IDE_CMD_WRMUL 0xc5
+#define IDE_CMD_SETMUL 0xc6
+
+// sectors moved per interrupt by RDMUL/WRMUL, a page of the swap area
+#define IDE_MULTIPLE  (PGSIZE/SECTOR_SIZE)
 
 // idequeue points to the buf now being read/written to the disk.
 // idequeue->qnext points to the next buf to be processed.
@@ -34,6 +38,13 @@ static struct buf *idequeue;
 static int havedisk1;
 static void idestart(struct buf*);
 
+// bytes moved for b
+static int
+bufsize(struct buf *b)
+{
+  return (b->flags & B_PAGE) ? PGSIZE : BSIZE;
+}
+
 // Wait for IDE disk to become ready.
 static int
 idewait(int checkerr)
@@ -65,6 +76,14 @@ ideinit(void)
     }
   }
 
+  // Let disk 1, which holds the swap area, move a page per interrupt.
+  if(havedisk1){
+    outb(0x3f6, 2);  // no interrupt
+    outb(0x1f2, IDE_MULTIPLE);
+    outb(0x1f7, IDE_CMD_SETMUL);
+    idewait(0);
+  }
+
   // Switch back to disk 0.
   outb(0x1f6, 0xe0 | (0<<4));
 }
@@ -75,14 +94,14 @@ idestart(struct buf *b)
 {
   if(b == 0)
     panic("idestart");
-  if(b->blockno >= FSSIZE)
+  if(b->blockno + bufsize(b)/BSIZE > FSSIZE + SWAPSIZE)
     panic("incorrect blockno");
-  int sector_per_block =  BSIZE/SECTOR_SIZE;
-  int sector = b->blockno * sector_per_block;
+  int sector_per_block =  bufsize(b)/SECTOR_SIZE;
+  int sector = b->blockno * (BSIZE/SECTOR_SIZE);
   int read_cmd = (sector_per_block == 1) ? IDE_CMD_READ :  IDE_CMD_RDMUL;
   int write_cmd = (sector_per_block == 1) ? IDE_CMD_WRITE : IDE_CMD_WRMUL;
 
-  if (sector_per_block > 7) panic("idestart");
+  if (sector_per_block > IDE_MULTIPLE) panic("idestart");
 
   idewait(0);
   outb(0x3f6, 0);  // generate interrupt
@@ -93,7 +112,7 @@ idestart(struct buf *b)
   outb(0x1f6, 0xe0 | ((b->dev&1)<<4) | ((sector>>24)&0x0f));
   if(b->flags & B_DIRTY){
     outb(0x1f7, write_cmd);
-    outsl(0x1f0, b->data, BSIZE/4);
+    outsl(0x1f0, b->data, bufsize(b)/4);
   } else {
     outb(0x1f7, read_cmd);
   }
@@ -116,7 +135,7 @@ ideintr(void)
 
   // Read data if needed.
   if(!(b->flags & B_DIRTY) && idewait(1) >= 0)
-    insl(0x1f0, b->data, BSIZE/4);
+    insl(0x1f0, b->data, bufsize(b)/4);
 
   // Wake process waiting for this buf.
   b->flags |= B_VALID;
@@ -136,29 +155,47 @@ ideintr(void)
 // Else if B_VALID is not set, read buf from disk, set B_VALID.
 void
 iderw(struct buf *b)
+{
+  iderwv(b, 1);
+}
+
+// Sync the n bufs of bufs[] with disk like iderw(). They are queued
+// together and the caller sleeps once, until the last one is done: the
+// queue is served in order, so the others are done by then.
+void
+iderwv(struct buf *bufs, int n)
 {
   struct buf **pp;
+  struct buf *b;
 
-  if(!holdingsleep(&b->lock))
-    panic("iderw: buf not locked");
-  if((b->flags & (B_VALID|B_DIRTY)) == B_VALID)
-    panic("iderw: nothing to do");
-  if(b->dev != 0 && !havedisk1)
-    panic("iderw: ide disk 1 not present");
+  for(b = bufs; b < bufs + n; b++){
+    if(!holdingsleep(&b->lock))
+      panic("iderw: buf not locked");
+    if((b->flags & (B_VALID|B_DIRTY)) == B_VALID)
+      panic("iderw: nothing to do");
+    if(b->dev != 0 && !havedisk1)
+      panic("iderw: ide disk 1 not present");
+  }
+  if(n == 0)
+    return;
 
   acquire(&idelock);  //DOC:acquire-lock
 
-  // Append b to idequeue.
-  b->qnext = 0;
+  // Append the bufs to idequeue.
   for(pp=&idequeue; *pp; pp=&(*pp)->qnext)  //DOC:insert-queue
     ;
-  *pp = b;
+  for(b = bufs; b < bufs + n; b++){
+    b->qnext = 0;
+    *pp = b;
+    pp = &b->qnext;
+  }
 
   // Start disk if necessary.
-  if(idequeue == b)
-    idestart(b);
+  if(idequeue == bufs)
+    idestart(bufs);
 
-  // Wait for request to finish.
+  // Wait for the last request to finish.
+  b = bufs + n - 1;
   while((b->flags & (B_VALID|B_DIRTY)) != B_VALID){
     sleep(b, &idelock);
   }
@@ -7,22 +7,74 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "proc.h"
 #include "spinlock.h"
 
 void freerange(void *vstart, void *vend);
+struct kcache;
+static void refillCache(struct kcache *c);
+static void drainCache(struct kcache *c);
+static struct run* stealFreeFrame(void);
+static struct run* buddyAlloc(int order);
+static void buddyFree(struct run *r, int order);
 extern char end[]; // first address after kernel loaded from ELF file
                    // defined by the kernel linker script in kernel.ld
 
 struct run {
   struct run *next;
+  struct run *prev;  // buddy free lists only
 };
 
+// Free frames not cached by a cpu are kept by a buddy allocator: a free
+// block of order k is 2^k frames, starting at a frame number that is a
+// multiple of 2^k, and its buddy is the block at that number xor 2^k.
+// A freed block is merged with its buddy while the buddy is free too.
+#define NOT_FREE 0xff
+
 struct {
   struct spinlock lock;
   int use_lock;
-  struct run *freelist;
+  struct run *freelist[BUDDY_MAX_ORDER + 1];  // free blocks of each order
+  uint noOfFreePages;
+  uint blocksInUse;                   // taken by kallocPages(order > 0)
+  uint refCount[PHYSTOP / PGSIZE];    // page tables mapping each frame
+  uchar freeOrder[PHYSTOP / PGSIZE];  // order of the free block starting at
+                                      // each frame, NOT_FREE if none
 } kmem;
 
+/*------------------------- my changes starts -----------------------------*/
+
+// Per-cpu caches of free frames. kalloc() and kfree() work on the cache of
+// their cpu under its own lock, which no other cpu takes except to steal
+// its last frames, and move KALLOC_BATCH frames at a time to and from the
+// buddy allocator. Frames go straight to the buddy allocator while booting.
+struct kcache {
+  struct spinlock lock;
+  struct run *freelist;
+  uint n;
+  struct kallocstats stats;
+};
+
+struct kcache kcache[NCPU];
+
+// Physical frame table: owner and virtual address of every frame that
+// holds a tracked user page. Owned frames are linked into a ring which
+// the clock hand of global page replacement sweeps.
+struct frameinfo {
+  struct proc *owner;  // 0 if the frame is not a tracked user page
+  uint vAddr;
+  int prev;            // ring of owned frames (pfn)
+  int next;
+};
+
+struct {
+  struct spinlock lock;
+  struct frameinfo frame[PHYSTOP / PGSIZE];
+  int hand;            // pfn of the global clock hand, -1 if the ring is empty
+} frametable;
+
+/*------------------------- my changes ends -----------------------------*/
+
 // Initialization happens in two phases.
 // 1. main() calls kinit1() while still using entrypgdir to place just
 // the pages mapped by entrypgdir on free list.
@@ -32,6 +84,11 @@ void
 kinit1(void *vstart, void *vend)
 {
   initlock(&kmem.lock, "kmem");
+  memset(kmem.freeOrder, NOT_FREE, sizeof(kmem.freeOrder));
+  for(int i = 0; i < NCPU; i++)
+    initlock(&kcache[i].lock, "kcache");
+  initlock(&frametable.lock, "frametable");
+  frametable.hand = -1;
   kmem.use_lock = 0;
   freerange(vstart, vend);
 }
@@ -66,16 +123,51 @@ kfree(char *v)
     panic("kfree");
   }
 
+  /*------------------------- my changes starts -----------------------------*/
+
+  // A frame shared copy-on-write is only freed with its last reference.
+  // The count is changed atomically, without kmem.lock. No one can take a
+  // new reference to a frame whose last one is being dropped.
+  uint *refCount = &kmem.refCount[V2P(v) / PGSIZE];
+  for(;;){
+    uint n = *refCount;
+    if(n <= 1){
+      *refCount = 0;
+      break;
+    }
+    if(__sync_bool_compare_and_swap(refCount, n, n - 1))
+      return;
+  }
+
+  /*------------------------- my changes ends -----------------------------*/
+
   // Fill with junk to catch dangling refs.
   memset(v, 1, PGSIZE);
 
-  if(kmem.use_lock)
-    acquire(&kmem.lock);
+  clearFrameOwner(v);
+
   r = (struct run*)v;
-  r->next = kmem.freelist;
-  kmem.freelist = r;
-  if(kmem.use_lock)
-    release(&kmem.lock);
+
+  /*------------------------- my changes starts -----------------------------*/
+  if(kmem.use_lock){
+    pushcli();
+    struct kcache *c = &kcache[cpuid()];
+    acquire(&c->lock);
+    popcli();
+
+    r->next = c->freelist;
+    c->freelist = r;
+    c->n++;
+    c->stats.frees++;
+    if(c->n > KALLOC_CACHE_MAX)
+      drainCache(c);
+
+    release(&c->lock);
+    return;
+  }
+
+  buddyFree(r, 0);
+  /*------------------------- my changes ends -----------------------------*/
 }
 
 // Allocate one 4096-byte page of physical memory.
@@ -86,13 +178,360 @@ kalloc(void)
 {
   struct run *r;
 
-  if(kmem.use_lock)
-    acquire(&kmem.lock);
-  r = kmem.freelist;
+  /*------------------------- my changes starts -----------------------------*/
+  if(kmem.use_lock){
+    pushcli();
+    struct kcache *c = &kcache[cpuid()];
+    acquire(&c->lock);
+    popcli();
+
+    if(c->freelist == 0)
+      refillCache(c);
+    if((r = c->freelist) != 0){
+      c->freelist = r->next;
+      c->n--;
+      c->stats.allocs++;
+    }
+
+    release(&c->lock);
+
+    // the free frames left may all sit in the caches of other cpus
+    if(r == 0)
+      r = stealFreeFrame();
+    if(r)
+      kmem.refCount[V2P(r) / PGSIZE] = 1;
+    return (char*)r;
+  }
+
+  r = buddyAlloc(0);
   if(r)
-    kmem.freelist = r->next;
-  if(kmem.use_lock)
-    release(&kmem.lock);
+    kmem.refCount[V2P(r) / PGSIZE] = 1;
+  /*------------------------- my changes ends -----------------------------*/
   return (char*)r;
 }
 
+/*------------------------- my changes starts -----------------------------*/
+
+// take kmem.lock, counting the times another cpu already held it
+static void
+acquireFreeList(struct kcache *c)
+{
+  if(kmem.lock.locked)
+    c->stats.lockContended++;
+  acquire(&kmem.lock);
+  c->stats.lockAcquires++;
+}
+
+static void
+pushFreeBlock(struct run *r, int order)
+{
+  r->prev = 0;
+  r->next = kmem.freelist[order];
+  if(r->next)
+    r->next->prev = r;
+  kmem.freelist[order] = r;
+  kmem.freeOrder[V2P(r) / PGSIZE] = order;
+}
+
+static void
+removeFreeBlock(struct run *r, int order)
+{
+  if(r->prev)
+    r->prev->next = r->next;
+  else
+    kmem.freelist[order] = r->next;
+  if(r->next)
+    r->next->prev = r->prev;
+  kmem.freeOrder[V2P(r) / PGSIZE] = NOT_FREE;
+}
+
+// Take a block of 2^order frames, splitting a larger block if no block of
+// that order is free. Returns 0 if there is none. The caller holds
+// kmem.lock once it is used.
+static struct run*
+buddyAlloc(int order)
+{
+  struct run *r;
+  int k;
+
+  for(k = order; k <= BUDDY_MAX_ORDER && kmem.freelist[k] == 0; k++)
+    ;
+  if(k > BUDDY_MAX_ORDER)
+    return 0;
+
+  r = kmem.freelist[k];
+  removeFreeBlock(r, k);
+
+  // the upper halves go back as free blocks of the lower orders
+  while(k > order){
+    k--;
+    pushFreeBlock((struct run*)((char*)r + (PGSIZE << k)), k);
+  }
+
+  kmem.noOfFreePages -= 1 << order;
+  return r;
+}
+
+// Give back a block of 2^order frames, merged with its buddies as far as
+// they are free. The caller holds kmem.lock once it is used.
+static void
+buddyFree(struct run *r, int order)
+{
+  uint pfn = V2P(r) / PGSIZE;
+
+  kmem.noOfFreePages += 1 << order;
+
+  while(order < BUDDY_MAX_ORDER){
+    uint buddy = pfn ^ (1 << order);
+
+    if(buddy >= PHYSTOP / PGSIZE || kmem.freeOrder[buddy] != order)
+      break;
+
+    removeFreeBlock((struct run*)P2V(buddy * PGSIZE), order);
+    pfn &= ~(1 << order);
+    order++;
+  }
+
+  pushFreeBlock((struct run*)P2V(pfn * PGSIZE), order);
+}
+
+// Allocate 2^order physically contiguous frames, for buffers that span
+// pages. Single frames come from kalloc() and its per-cpu caches. Returns
+// 0 if no free block is large enough.
+char*
+kallocPages(int order)
+{
+  struct run *r;
+
+  if(order == 0)
+    return kalloc();
+  if(order < 0 || order > BUDDY_MAX_ORDER)
+    return 0;
+
+  acquire(&kmem.lock);
+  r = buddyAlloc(order);
+  if(r)
+    kmem.blocksInUse++;
+  release(&kmem.lock);
+
+  if(r)
+    kmem.refCount[V2P(r) / PGSIZE] = 1;
+  return (char*)r;
+}
+
+// Free 2^order frames returned by kallocPages(order).
+void
+kfreePages(char *v, int order)
+{
+  if(order == 0){
+    kfree(v);
+    return;
+  }
+
+  if(order < 0 || order > BUDDY_MAX_ORDER || (V2P(v) / PGSIZE) % (1 << order) != 0 ||
+     v < end || V2P(v) + (PGSIZE << order) > PHYSTOP)
+    panic("kfreePages");
+
+  // Fill with junk to catch dangling refs.
+  memset(v, 1, PGSIZE << order);
+  kmem.refCount[V2P(v) / PGSIZE] = 0;
+
+  acquire(&kmem.lock);
+  buddyFree((struct run*)v, order);
+  kmem.blocksInUse--;
+  release(&kmem.lock);
+}
+
+// Free blocks of each order of the buddy allocator, a measure of how
+// fragmented free memory is. Frames in the per-cpu caches are not counted.
+void
+getBuddyStats(struct buddystats *stats)
+{
+  memset(stats, 0, sizeof(*stats));
+  stats->largestOrder = -1;
+
+  acquire(&kmem.lock);
+  for(int k = 0; k <= BUDDY_MAX_ORDER; k++){
+    for(struct run *r = kmem.freelist[k]; r; r = r->next)
+      stats->freeBlocks[k]++;
+    if(stats->freeBlocks[k] > 0)
+      stats->largestOrder = k;
+  }
+  stats->freePages = kmem.noOfFreePages;
+  stats->blocksInUse = kmem.blocksInUse;
+  release(&kmem.lock);
+}
+
+// Move up to KALLOC_BATCH frames from the buddy allocator to the empty
+// cache c. The caller holds c->lock.
+static void
+refillCache(struct kcache *c)
+{
+  struct run *r;
+
+  acquireFreeList(c);
+  for(int i = 0; i < KALLOC_BATCH && (r = buddyAlloc(0)) != 0; i++){
+    r->next = c->freelist;
+    c->freelist = r;
+    c->n++;
+  }
+  release(&kmem.lock);
+  c->stats.refills++;
+}
+
+// Move KALLOC_BATCH frames of the full cache c back to the buddy
+// allocator. The caller holds c->lock.
+static void
+drainCache(struct kcache *c)
+{
+  struct run *r;
+
+  acquireFreeList(c);
+  for(int i = 0; i < KALLOC_BATCH && (r = c->freelist) != 0; i++){
+    c->freelist = r->next;
+    c->n--;
+    buddyFree(r, 0);
+  }
+  release(&kmem.lock);
+  c->stats.drains++;
+}
+
+// Take a frame from the cache of any cpu, when both the cache of this cpu
+// and the buddy allocator are empty. Returns 0 if there is no free frame at all.
+static struct run*
+stealFreeFrame(void)
+{
+  struct run *r = 0;
+
+  for(int i = 0; i < ncpu && r == 0; i++){
+    acquire(&kcache[i].lock);
+    if((r = kcache[i].freelist) != 0){
+      kcache[i].freelist = r->next;
+      kcache[i].n--;
+      kcache[i].stats.steals++;
+    }
+    release(&kcache[i].lock);
+  }
+
+  return r;
+}
+
+// Sum of the allocator counters of all cpus.
+void
+getKallocStats(struct kallocstats *stats)
+{
+  memset(stats, 0, sizeof(*stats));
+  for(int i = 0; i < NCPU; i++){
+    stats->allocs += kcache[i].stats.allocs;
+    stats->frees += kcache[i].stats.frees;
+    stats->refills += kcache[i].stats.refills;
+    stats->drains += kcache[i].stats.drains;
+    stats->steals += kcache[i].stats.steals;
+    stats->lockAcquires += kcache[i].stats.lockAcquires;
+    stats->lockContended += kcache[i].stats.lockContended;
+  }
+}
+
+// free frames in the buddy allocator and in the caches of all cpus; the caches
+// are read without their locks, the sum is only a hint
+uint
+getNoOfFreePages(void)
+{
+  uint n = kmem.noOfFreePages;
+
+  for(int i = 0; i < NCPU; i++)
+    n += kcache[i].n;
+  return n;
+}
+
+// Another page table maps frame v (copy-on-write fork). The shared zero
+// frame is mapped by every zero page of every process, so the count is a
+// full uint, and a wrap to 0 would free a frame that is still mapped.
+void
+incFrameRefCount(char *v)
+{
+  if(__sync_fetch_and_add(&kmem.refCount[V2P(v) / PGSIZE], 1) == 0xffffffff)
+    panic("incFrameRefCount: overflow");
+}
+
+int
+getFrameRefCount(char *v)
+{
+  return kmem.refCount[V2P(v) / PGSIZE];
+}
+
+// Record that frame v holds the page at vAddr of process p.
+void
+setFrameOwner(char *v, struct proc *p, uint vAddr)
+{
+  int pfn = V2P(v) / PGSIZE;
+  struct frameinfo *f = &frametable.frame[pfn];
+
+  acquire(&frametable.lock);
+  if(f->owner == 0){
+    // link the frame just behind the hand
+    if(frametable.hand == -1){
+      f->prev = pfn;
+      f->next = pfn;
+      frametable.hand = pfn;
+    } else {
+      struct frameinfo *hand = &frametable.frame[frametable.hand];
+      f->prev = hand->prev;
+      f->next = frametable.hand;
+      frametable.frame[hand->prev].next = pfn;
+      hand->prev = pfn;
+    }
+  }
+  f->owner = p;
+  f->vAddr = vAddr;
+  release(&frametable.lock);
+}
+
+void
+clearFrameOwner(char *v)
+{
+  int pfn = V2P(v) / PGSIZE;
+  struct frameinfo *f = &frametable.frame[pfn];
+
+  // frames freed while booting were never owned
+  if(f->owner == 0)
+    return;
+
+  acquire(&frametable.lock);
+  if(f->owner != 0){
+    if(f->next == pfn){
+      frametable.hand = -1;
+    } else {
+      frametable.frame[f->prev].next = f->next;
+      frametable.frame[f->next].prev = f->prev;
+      if(frametable.hand == pfn)
+        frametable.hand = f->next;
+    }
+    f->owner = 0;
+  }
+  release(&frametable.lock);
+}
+
+// Return the frame under the global clock hand and advance the hand.
+// Returns 0 if no frame is owned. The owner may change as soon as the
+// lock is released, so the caller has to check it again.
+char*
+nextFrameOfGlobalClock(struct proc **owner, uint *vAddr)
+{
+  int pfn;
+
+  acquire(&frametable.lock);
+  pfn = frametable.hand;
+  if(pfn == -1){
+    release(&frametable.lock);
+    return 0;
+  }
+  *owner = frametable.frame[pfn].owner;
+  *vAddr = frametable.frame[pfn].vAddr;
+  frametable.hand = frametable.frame[pfn].next;
+  release(&frametable.lock);
+
+  return P2V(pfn * PGSIZE);
+}
+
+/*------------------------- my changes ends -----------------------------*/
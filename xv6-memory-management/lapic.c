@@ -113,6 +113,18 @@ lapiceoi(void)
     lapicw(EOI, 0);
 }
 
+/*------------------------- my changes starts -----------------------------*/
+// Send an interrupt with the given vector to the cpu with the given apic id.
+void
+lapicipi(uchar apicid, int vector)
+{
+  lapicw(ICRHI, apicid<<24);
+  lapicw(ICRLO, FIXED | vector);
+  while(lapic[ICRLO] & DELIVS)
+    ;
+}
+/*------------------------- my changes ends -----------------------------*/
+
 // Spin for a given number of microseconds.
 // On real hardware would want to tune this dynamically.
 void
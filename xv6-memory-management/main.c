@@ -19,6 +19,7 @@ main(void)
 {
   kinit1(end, P2V(4*1024*1024)); // phys page allocator
   kvmalloc();      // kernel page table
+  pgeinit();       // global kernel mappings
   mpinit();        // detect other processors
   lapicinit();     // interrupt controller
   seginit();       // segment descriptors
@@ -30,10 +31,18 @@ main(void)
   tvinit();        // trap vectors
   binit();         // buffer cache
   fileinit();      // file table
+  swapinit();      // raw swap area after the file system
+  zswapinit();     // compressed swap pool
   ideinit();       // disk 
   startothers();   // start other processors
   kinit2(P2V(4*1024*1024), P2V(PHYSTOP)); // must come after startothers()
+  slabinit();      // small kernel object caches
+  pipeinit();      // pipe cache
+  pageinfoinit();  // paging meta-data caches
+  zeroframeinit(); // shared zero frame
   userinit();      // first user process
+  kswapdinit();    // page-out daemon
+  ksmdinit();      // same-page merging daemon
   mpmain();        // finish this processor's setup
 }
 
@@ -42,6 +51,7 @@ static void
 mpenter(void)
 {
   switchkvm();
+  pgeinit();
   seginit();
   lapicinit();
   mpmain();
@@ -81,7 +91,7 @@ startothers(void)
     // Tell entryother.S what stack to use, where to enter, and what
     // pgdir to use. We cannot use kpgdir yet, because the AP processor
     // is running in low  memory, so we use entrypgdir for the APs too.
-    stack = kalloc();
+    stack = kallocPages(KSTACKORDER);
     *(void**)(code-4) = stack + KSTACKSIZE;
     *(void(**)(void))(code-8) = mpenter;
     *(int**)(code-12) = (void *) V2P(entrypgdir);
@@ -32,6 +32,13 @@ ideintr(void)
   // no-op
 }
 
+void
+iderwv(struct buf *bufs, int n)
+{
+  for(int i = 0; i < n; i++)
+    iderw(&bufs[i]);
+}
+
 // Sync buf with disk.
 // If B_DIRTY is set, write buf to disk, clear B_DIRTY, set B_VALID.
 // Else if B_VALID is not set, read buf from disk, set B_VALID.
@@ -39,6 +46,7 @@ void
 iderw(struct buf *b)
 {
   uchar *p;
+  int n;
 
   if(!holdingsleep(&b->lock))
     panic("iderw: buf not locked");
@@ -50,11 +58,12 @@ iderw(struct buf *b)
     panic("iderw: block out of range");
 
   p = memdisk + b->blockno*BSIZE;
+  n = (b->flags & B_PAGE) ? PGSIZE : BSIZE;
 
   if(b->flags & B_DIRTY){
     b->flags &= ~B_DIRTY;
-    memmove(p, b->data, BSIZE);
+    memmove(p, b->data, n);
   } else
-    memmove(b->data, p, BSIZE);
+    memmove(b->data, p, n);
   b->flags |= B_VALID;
 }
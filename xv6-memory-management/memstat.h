@@ -0,0 +1,21 @@
+// Memory counters of the whole system, filled in by memStat().
+struct memstat {
+  uint freePages;       // free frames
+  uint swapSlotsUsed;   // slots of the swap area in use
+  uint zswapStores;     // pages offered to the compressed swap pool
+  uint zswapLoads;      // faults served from the pool
+  uint zswapRejects;    // pages that did not compress well enough
+  uint mergedPages;     // pages merged by ksmd
+  uint zeroPagesMerged; // pages of zeros mapped to the shared zero frame by ksmd
+  uint ncpu;
+  uint tlbShootdowns;   // invalidations another cpu had to take part in
+  uint kallocAllocs;    // frames handed out by the caches of the cpus
+  uint kallocFrees;     // frames given back to them
+  uint buddyFreePages;  // free frames in the buddy allocator, not in a cache
+  int buddyLargestOrder; // of a free block, -1 if there is none
+  uint slabObjsInUse;   // objects handed out by all object caches
+  uint buddyBlocksInUse; // blocks of more than one frame (kernel stacks)
+  uint kswapdWakeups;   // rounds of kswapd below the low watermark
+  uint kswapdPageOuts;  // pages written out ahead of demand by kswapd
+  uint directPageOuts;  // pages evicted by an allocating or faulting process
+};
@@ -10,6 +10,7 @@
 #define CR0_PG          0x80000000      // Paging
 
 #define CR4_PSE         0x00000010      // Page size extension
+#define CR4_PGE         0x00000080      // Page global enable
 
 // various segment selectors.
 #define SEG_KCODE 1  // kernel code
@@ -86,11 +87,35 @@ struct segdesc {
 
 
 /*------------------------- my changes starts -----------------------------*/
-#define MAX_PSYC_PAGES 15
-#define MAX_TOTAL_PAGES 30
-#define MAX_SWAPFILE_PAGES (MAX_TOTAL_PAGES - MAX_PSYC_PAGES)
+#define MAX_PSYC_PAGES 15   // default resident page limit, see setMemoryLimits()
+#define MAX_TOTAL_PAGES 30  // default process size limit in pages
+#define MAX_PROC_PAGES 8192 // largest size limit setMemoryLimits() accepts, 32 MB
+#define MAX_PINNED_RANGES 4 // user buffers one system call can pin, see argptr()
 #define FIFO 1
 #define NRU 2
+#define CLOCK 3
+#define AGING 4
+#define AGING_INTERVAL 1  // default timer ticks between two samples of PTE_A
+#define WSCLOCK 5
+#define WSCLOCK_TAU 20    // default working set window in ticks of process run time
+#define WSCLOCK_MAX_WRITEBACKS 2  // dirty old pages written back by one scan
+#define GLOBAL_FREE_PAGES_LOW 256 // global replacement evicts below this many free frames
+#define KSWAPD_LOW_WATERMARK 512  // kswapd is woken below this many free frames
+#define KSWAPD_HIGH_WATERMARK 768 // kswapd pages out until this many frames are free
+#define SWAP_READAHEAD 0          // default pages read along with a swapped-in page
+#define SWAP_READAHEAD_MAX 8      // upper limit of setSwapReadAhead()
+#define SWAP_BATCH_MAX 8          // pages evicted and written by one transaction
+#define ZSWAP_POOL_PAGES 64       // frames of compressed pages kept ahead of the swap area
+#define ZSWAP_MAX_WRITEBACKS 4    // oldest pages a full pool writes to disk for a new one
+#define KSM_PAGES_TO_SCAN 0       // default pages merged per round of ksmd, 0 is off
+#define KSM_SLEEP_TICKS 10        // default ticks between two rounds of ksmd
+#define KSM_TABLE_SIZE 256        // pages remembered as merge candidates
+#define TLB_FLUSH_MAX_PAGES 32    // pages invalidated one by one before a full flush
+#define KALLOC_BATCH 16           // frames moved between a cpu cache and the buddy allocator
+#define KALLOC_CACHE_MAX 64       // frames a cpu cache holds before it is drained
+#define BUDDY_MAX_ORDER 10        // largest block of the buddy allocator, 2^10 frames
+#define SLAB_MAX_CACHES 8         // object caches of the slab allocator
+#define SLAB_MAGAZINE_SIZE 16     // free objects of a cache held by each cpu
 /*------------------------- my changes ends -----------------------------*/
 
 
@@ -106,8 +131,13 @@ struct segdesc {
 #define PTE_U           0x004   // User
 #define PTE_PS          0x080   // Page Size
 #define PTE_A           0x020   // Accessed
+#define PTE_G           0x100   // Global, kept in the TLB across %cr3 loads
 #define PTE_PG          0x200   // Paged out to secondary storage
 #define PTE_D           0x040   // Dirty bit to check if modified or not 
+#define PTE_COW         0x400   // Shared copy-on-write, writable once copied
+
+// Page fault error code bits
+#define FEC_WR          0x002   // Fault caused by a write
 
 // Address in page table or page directory entry
 #define PTE_ADDR(pte)   ((uint)(pte) & ~0xFFF)
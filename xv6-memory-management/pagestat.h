@@ -0,0 +1,9 @@
+// Paging counters of a process, filled in by pageStat().
+struct pagestat {
+  uint physicalPages;   // resident pages
+  uint swappedPages;    // pages in a swap slot and not resident
+  uint swapCachedPages; // resident pages that still have their swap slot
+  uint zeroPages;       // evicted all-zero pages, kept nowhere
+  uint pageFaults;
+  uint readAheadPages;  // pages read along with a faulting page
+};
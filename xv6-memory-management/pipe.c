@@ -19,6 +19,17 @@ struct pipe {
   int writeopen;  // write fd is still open
 };
 
+/*------------------------- my changes starts -----------------------------*/
+// pipes come from a slab cache instead of taking a whole page each
+static struct kmemcache *pipeCache;
+
+void
+pipeinit(void)
+{
+  pipeCache = kmemCacheCreate("pipe", sizeof(struct pipe));
+}
+/*------------------------- my changes ends -----------------------------*/
+
 int
 pipealloc(struct file **f0, struct file **f1)
 {
@@ -28,7 +39,7 @@ pipealloc(struct file **f0, struct file **f1)
   *f0 = *f1 = 0;
   if((*f0 = filealloc()) == 0 || (*f1 = filealloc()) == 0)
     goto bad;
-  if((p = (struct pipe*)kalloc()) == 0)
+  if((p = (struct pipe*)kmemCacheAlloc(pipeCache)) == 0)
     goto bad;
   p->readopen = 1;
   p->writeopen = 1;
@@ -48,7 +59,7 @@ pipealloc(struct file **f0, struct file **f1)
 //PAGEBREAK: 20
  bad:
   if(p)
-    kfree((char*)p);
+    kmemCacheFree(pipeCache, p);
   if(*f0)
     fileclose(*f0);
   if(*f1)
@@ -69,7 +80,7 @@ pipeclose(struct pipe *p, int writable)
   }
   if(p->readopen == 0 && p->writeopen == 0){
     release(&p->lock);
-    kfree((char*)p);
+    kmemCacheFree(pipeCache, p);
   } else
     release(&p->lock);
 }
@@ -13,9 +13,12 @@ struct {
 } ptable;
 
 static struct proc *initproc;
+static struct proc *kswapdproc;
 
 int nextpid = 1;
 extern void forkret(void);
+void kswapd(void);
+void ksmd(void);
 extern void trapret(void);
 
 static void wakeup1(void *chan);
@@ -92,7 +95,7 @@ found:
   release(&ptable.lock);
 
   // Allocate kernel stack.
-  if((p->kstack = kalloc()) == 0){
+  if((p->kstack = kallocPages(KSTACKORDER)) == 0){
     p->state = UNUSED;
     return 0;
   }
@@ -101,26 +104,22 @@ found:
 
   /*------------------------- my changes starts -----------------------------*/
 
-  p->noOfPhysicalPages = 0;
-  p->noOfSwapFilePages = 0;
   p->noOfPageFaults = 0;
-  p->fifoHead = 0;
-  p->fifoTail = 0;
   p->usedAlgorithm = FIFO;
   //p->usedAlgorithm = NRU;
-  p->nruIndex = -1;
-
-  // checking if the curproc is not init(1) or sh(2). 
-  if(p->pid > 2){
-      createSwapFile(p);
-
-      for (int i=0; i < MAX_SWAPFILE_PAGES; i++){
-        p->swapFilePages[i] = -1;
-      }
-      for(int i = 0; i < MAX_PSYC_PAGES; i++){
-        p->physicalPages[i] = -1;
-      }
-  }
+  p->agingInterval = AGING_INTERVAL;
+  p->agingTicks = 0;
+  p->runTicks = 0;
+  p->wsTau = WSCLOCK_TAU;
+  p->pagingLocked = 0;
+  p->maxPhysicalPages = MAX_PSYC_PAGES;
+  p->maxTotalPages = MAX_TOTAL_PAGES;
+  p->lazyAllocation = 0;
+  p->swapReadAhead = SWAP_READAHEAD;
+  p->noOfReadAheadPages = 0;
+  p->noOfPinnedRanges = 0;
+  p->noOfPinnedPages = 0;
+  removeInfoOfAllPages(p);
 
   /*------------------------- my changes ends -----------------------------*/
 
@@ -179,6 +178,172 @@ userinit(void)
   release(&ptable.lock);
 }
 
+/*------------------------- my changes starts -----------------------------*/
+
+// Set up the page-out daemon, a kernel thread that starts in kswapd().
+void
+kswapdinit(void)
+{
+  struct proc *p;
+
+  p = allocproc();
+
+  // the daemon takes no pid, so that init and sh keep the pids 1 and 2
+  p->pid = 0;
+  nextpid--;
+
+  // scheduler() switches to a page table, the daemon only uses the kernel part
+  if((p->pgdir = setupkvm()) == 0)
+    panic("kswapdinit: out of memory?");
+  p->context->eip = (uint)kswapd;
+  safestrcpy(p->name, "kswapd", sizeof(p->name));
+  kswapdproc = p;
+
+  acquire(&ptable.lock);
+
+  p->state = RUNNABLE;
+
+  release(&ptable.lock);
+}
+
+// Page-out daemon. It sleeps until the free frames drop below the low
+// watermark, then writes pages of the processes to the swap area until
+// the high watermark is reached, so that a page fault mostly only reads.
+void
+kswapd(void)
+{
+  // Still holding ptable.lock from scheduler.
+  release(&ptable.lock);
+
+  for(;;){
+    acquire(&ptable.lock);
+    while(!isFreeMemoryLow())
+      sleep(kswapdproc, &ptable.lock);
+    release(&ptable.lock);
+
+    if(balanceFreeFrames() == -1){
+      // every frame is busy or shared, try again on the next tick
+      acquire(&tickslock);
+      sleep(&ticks, &tickslock);
+      release(&tickslock);
+    }
+  }
+}
+
+void
+wakeupkswapd(void)
+{
+  if(kswapdproc != 0)
+    wakeup(kswapdproc);
+}
+
+// Set up the same-page merging daemon, a kernel thread that starts in ksmd().
+void
+ksmdinit(void)
+{
+  struct proc *p;
+
+  p = allocproc();
+
+  p->pid = 0;
+  nextpid--;
+
+  if((p->pgdir = setupkvm()) == 0)
+    panic("ksmdinit: out of memory?");
+  p->context->eip = (uint)ksmd;
+  safestrcpy(p->name, "ksmd", sizeof(p->name));
+
+  acquire(&ptable.lock);
+
+  p->state = RUNNABLE;
+
+  release(&ptable.lock);
+}
+
+// Same-page merging daemon. Every ksmSleepTicks ticks it hands the next
+// ksmPagesToScan resident pages of the tracked processes to
+// mergeSamePage(). It is idle while ksmPagesToScan is 0.
+void
+ksmd(void)
+{
+  // Still holding ptable.lock from scheduler.
+  release(&ptable.lock);
+
+  for(;;){
+    acquire(&tickslock);
+    uint ticks0 = ticks;
+    while(ksmPagesToScan == 0 || ticks - ticks0 < ksmSleepTicks)
+      sleep(&ticks, &tickslock);
+    release(&tickslock);
+
+    scanSamePages(ksmPagesToScan);
+  }
+}
+
+// where the scan of ksmd() goes on from: a slot of ptable and an address
+static int ksmProcIndex;
+static uint ksmVAddr;
+
+// Scan the next n resident pages for same-page merging, process by process.
+void
+scanSamePages(int n)
+{
+  int scanned = 0;
+
+  for(int visited = 0; scanned < n && visited <= NPROC; visited++){
+    struct proc *p = &ptable.proc[ksmProcIndex];
+
+    if(p->pid > 2 && tryAcquirePagingLock(p)){
+      for(; scanned < n && ksmVAddr < p->sz; ksmVAddr += PGSIZE){
+        if(isPageResident(p, ksmVAddr)){
+          mergeSamePage(p, ksmVAddr);
+          scanned++;
+        }
+      }
+
+      bool isDone = ksmVAddr >= p->sz;
+      releasePagingLock(p);
+      if(!isDone)
+        return;
+    }
+
+    ksmVAddr = 0;
+    if(++ksmProcIndex == NPROC){
+      ksmProcIndex = 0;
+      ksmStats.fullScans++;
+    }
+  }
+}
+
+// Take ptable.lock if neither p nor q is running and no cpu keeps their
+// page tables loaded from running them last, so that they stay off the
+// CPUs, and out of every TLB, until releaseProcTable(). Returns false
+// without the lock otherwise.
+bool
+acquireProcTableIfIdle(struct proc *p, struct proc *q)
+{
+  acquire(&ptable.lock);
+  if(p->state == RUNNING || q->state == RUNNING){
+    release(&ptable.lock);
+    return false;
+  }
+  for(int i = 0; i < ncpu; i++){
+    if(cpus[i].pgdir == p->pgdir || cpus[i].pgdir == q->pgdir){
+      release(&ptable.lock);
+      return false;
+    }
+  }
+  return true;
+}
+
+void
+releaseProcTable(void)
+{
+  release(&ptable.lock);
+}
+
+/*------------------------- my changes ends -----------------------------*/
+
 // Grow current process's memory by n bytes.
 // Return 0 on success, -1 on failure.
 int
@@ -190,14 +355,24 @@ growproc(int n)
   sz = curproc->sz;
 
   if(n > 0){
-    if((sz = allocuvm(curproc->pgdir, sz, sz + n)) == 0)
+    /*------------------------- my changes starts -----------------------------*/
+    // lazy allocation only reserves the address space, see handlePageFault()
+    if(curproc->lazyAllocation){
+      if((sz = reserveuvm(curproc, sz, sz + n)) == 0)
+        return -1;
+    }
+    /*------------------------- my changes ends -----------------------------*/
+    else if((sz = allocuvm(curproc->pgdir, sz, sz + n)) == 0)
       return -1;
   } else if(n < 0){
     if((sz = deallocuvm(curproc->pgdir, sz, sz + n)) == 0)
       return -1;
   }
   curproc->sz = sz;
-  switchuvm(curproc);
+  /*------------------------- my changes starts -----------------------------*/
+  // no switchuvm(): new pages were not present before, so no translation
+  // of them is cached, and deallocuvm() invalidated the pages it freed
+  /*------------------------- my changes ends -----------------------------*/
   return 0;
 }
 
@@ -216,9 +391,21 @@ fork(void)
     return -1;
   }
   
+  /*------------------------- my changes starts -----------------------------*/
+
+  // pages of the parent must not be evicted while they are copied
+  if(curproc->pid > 2){
+    acquirePagingLock(curproc);
+  }
+
+  /*------------------------- my changes ends -----------------------------*/
+
   // Copy process state from proc.
   if((np->pgdir = copyuvm(curproc->pgdir, curproc->sz)) == 0){
-      kfree(np->kstack);
+      if(curproc->pid > 2){
+        releasePagingLock(curproc);
+      }
+      kfreePages(np->kstack, KSTACKORDER);
       np->kstack = 0;
       np->state = UNUSED;
       return -1;
@@ -229,24 +416,35 @@ fork(void)
 
   // checking if the curproc is not init(1) or sh(2)
   if(curproc->pid > 2){ 
-    // as swapFile is not copied, we have to copy it manually
-    copyContentsOfSwapFile(curproc, np);
-
-    for (int i = 0; i < MAX_PSYC_PAGES; i++){
-      np->physicalPages[i] = curproc->physicalPages[i];
-    }
-
-    for (int i = 0; i < MAX_SWAPFILE_PAGES; i++){
-      np->swapFilePages[i] = curproc->swapFilePages[i];
+    // the child shares the swap slots of the parent, as it shares its frames
+    if(copyPageInfo(curproc, np) == -1){
+      releasePagingLock(curproc);
+      freePageInfo(np);
+      freevm(np->pgdir);
+      np->pgdir = 0;
+      kfreePages(np->kstack, KSTACKORDER);
+      np->kstack = 0;
+      np->state = UNUSED;
+      return -1;
     }
 
     np->noOfPhysicalPages = curproc->noOfPhysicalPages;
     np->noOfSwapFilePages = curproc->noOfSwapFilePages;
     np->noOfPageFaults = curproc->noOfPageFaults;
+    np->fifoHead = curproc->fifoHead;
     np->usedAlgorithm = curproc->usedAlgorithm;
-    np->nruIndex = curproc->nruIndex;    
+    np->agingInterval = curproc->agingInterval;
+    np->runTicks = curproc->runTicks;
+    np->wsTau = curproc->wsTau;
+    np->swapReadAhead = curproc->swapReadAhead;
+    np->maxPhysicalPages = curproc->maxPhysicalPages;
+    np->maxTotalPages = curproc->maxTotalPages;
+
+    releasePagingLock(curproc);
   }
 
+  np->lazyAllocation = curproc->lazyAllocation;
+
   /*------------------------- my changes ends -----------------------------*/
 
   np->parent = curproc;
@@ -259,6 +457,14 @@ fork(void)
       np->ofile[i] = filedup(curproc->ofile[i]);
   np->cwd = idup(curproc->cwd);
 
+  /*------------------------- my changes starts -----------------------------*/
+  // the child faults in the pages of the executable that are not loaded yet
+  if(curproc->image)
+    np->image = idup(curproc->image);
+  np->noOfImageSegments = curproc->noOfImageSegments;
+  memmove(np->imageSegments, curproc->imageSegments, sizeof(curproc->imageSegments));
+  /*------------------------- my changes ends -----------------------------*/
+
   safestrcpy(np->name, curproc->name, sizeof(curproc->name));
 
   pid = np->pid;
@@ -289,18 +495,15 @@ exit(void)
 
   // checking if the curproc is not init(1) or sh(2)
   if(curproc->pid > 2){
-    if(removeSwapFile(curproc) != 0){
-      panic("exit: removeSwapFile(error)");
-    }
+    acquirePagingLock(curproc);
 
     curproc->sz = 0;
-    curproc->noOfPhysicalPages = 0;
-    curproc->noOfSwapFilePages = 0;
     curproc->noOfPageFaults = 0;
-    curproc->fifoHead = 0;
-    curproc->fifoTail = 0;
     
+    // the swap slots of its pages are released with the paging meta-data
     removeInfoOfAllPages(curproc);
+
+    releasePagingLock(curproc);
   }
 
   /*------------------------- my changes ends -----------------------------*/
@@ -316,8 +519,13 @@ exit(void)
 
   begin_op();
   iput(curproc->cwd);
+  /*------------------------- my changes starts -----------------------------*/
+  if(curproc->image)
+    iput(curproc->image);
+  /*------------------------- my changes ends -----------------------------*/
   end_op();
   curproc->cwd = 0;
+  curproc->image = 0;
 
   acquire(&ptable.lock);
 
@@ -347,6 +555,7 @@ wait(void)
   struct proc *p;
   int havekids, pid;
   struct proc *curproc = myproc();
+  pde_t *pgdir;
   
   acquire(&ptable.lock);
   for(;;){
@@ -359,34 +568,18 @@ wait(void)
       if(p->state == ZOMBIE){
         // Found one.
         pid = p->pid;
-        kfree(p->kstack);
+        kfreePages(p->kstack, KSTACKORDER);
         p->kstack = 0;
-        freevm(p->pgdir);
+        pgdir = p->pgdir;
         p->pid = 0;
         p->parent = 0;
         p->name[0] = 0;
         p->killed = 0;
         p->state = UNUSED;
 
-        /*------------------------- my changes starts -----------------------------*/
-
-        // if(curproc != 0 && curproc->pid > 2){
-        //   if(removeSwapFile(curproc) != 0){
-        //     panic("exit: removeSwapFile(error)");
-        //   }
-
-        //   for (int i = 0; i < MAX_PSYC_PAGES; i++){
-        //     p->physicalPages[i] = -2;
-        //   }
-
-        //   for (int i = 0; i < MAX_SWAPFILE_PAGES; i++){
-        //     p->swapFilePages[i] = -2;
-        //   }
-        // }
-
-        /*------------------------- my changes ends -----------------------------*/
-
         release(&ptable.lock);
+        // may wait for another cpu, without ptable.lock
+        freeUserPgdir(pgdir);
         return pid;
       }
     }
@@ -415,6 +608,7 @@ scheduler(void)
 {
   struct proc *p;
   struct cpu *c = mycpu();
+  int ran;
   c->proc = 0;
   
   for(;;){
@@ -423,9 +617,11 @@ scheduler(void)
 
     // Loop over process table looking for process to run.
     acquire(&ptable.lock);
+    ran = 0;
     for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
       if(p->state != RUNNABLE)
         continue;
+      ran = 1;
 
       // Switch to chosen process.  It is the process's job
       // to release ptable.lock and then reacquire it
@@ -435,12 +631,25 @@ scheduler(void)
       p->state = RUNNING;
 
       swtch(&(c->scheduler), p->context);
-      switchkvm();
+      /*------------------------- my changes starts -----------------------------*/
+      // no switchkvm(): the page table of p stays loaded, across passes
+      // too, so that running p again next needs no %cr3 write. The
+      // tlb shootdowns reach this cpu through c->pgdir, and
+      // freeUserPgdir() waits until it has moved on.
+      /*------------------------- my changes ends -----------------------------*/
 
       // Process is done running for now.
       // It should have changed its p->state before coming back.
       c->proc = 0;
     }
+    /*------------------------- my changes starts -----------------------------*/
+    // a cpu that found nothing to run goes idle on the kernel page table,
+    // so it holds no page table of a process that may have exited
+    if(!ran && c->pgdir != 0){
+      switchkvm();
+      c->pgdir = 0;
+    }
+    /*------------------------- my changes ends -----------------------------*/
     release(&ptable.lock);
 
   }
@@ -716,15 +925,67 @@ procdump(void)
 /*------------------------- my changes starts -----------------------------*/
 
 void removeInfoOfAllPages(struct proc* p){
-  for (int i = 0; i < MAX_PSYC_PAGES; ++i) {
-		p->physicalPages[i] = -1;
-	}
+	freePageInfo(p);
 
-	for (int i = 0; i < MAX_SWAPFILE_PAGES; ++i) {
-		p->swapFilePages[i] = -1;
-	}
+	p->noOfPhysicalPages = 0;
+	p->noOfSwapFilePages = 0;
+	p->fifoHead = -1;
 }
 
-/*------------------------- my changes ends -----------------------------*/
+// Free the page table of a process that has exited or replaced it in
+// exec(). The cpu that ran the process last may still have it loaded in
+// its scheduler; it loads another one within one pass of the scheduler,
+// when it runs something else or goes idle.
+void freeUserPgdir(pde_t *pgdir){
+  int loaded;
+
+  do{
+    loaded = 0;
+    acquire(&ptable.lock);
+    for(int i = 0; i < ncpu; i++){
+      if(&cpus[i] != mycpu() && cpus[i].pgdir == pgdir){
+        loaded = 1;
+      }
+    }
+    release(&ptable.lock);
+  } while(loaded);
+
+  freevm(pgdir);
+}
+
+// The paging meta-data of a process is changed by the process itself and,
+// under global replacement, by other processes evicting its pages. Both
+// sides may sleep on swap I/O, so this is a sleeping lock.
+void acquirePagingLock(struct proc *p){
+  acquire(&ptable.lock);
+  while(p->pagingLocked){
+    sleep(&p->pagingLocked, &ptable.lock);
+  }
+  p->pagingLocked = 1;
+  release(&ptable.lock);
+}
+
+// Like acquirePagingLock(), but gives up instead of sleeping.
+// Only tracked processes (pid > 2) that are alive can be locked.
+bool tryAcquirePagingLock(struct proc *p){
+  bool acquired = false;
 
+  acquire(&ptable.lock);
+  if(!p->pagingLocked && p->pid > 2 &&
+      (p->state == SLEEPING || p->state == RUNNABLE || p->state == RUNNING)){
+    p->pagingLocked = 1;
+    acquired = true;
+  }
+  release(&ptable.lock);
+
+  return acquired;
+}
+
+void releasePagingLock(struct proc *p){
+  acquire(&ptable.lock);
+  p->pagingLocked = 0;
+  wakeup1(&p->pagingLocked);
+  release(&ptable.lock);
+}
 
+/*------------------------- my changes ends -----------------------------*/
\ No newline at end of file
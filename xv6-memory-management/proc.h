@@ -8,6 +8,10 @@ struct cpu {
   int ncli;                    // Depth of pushcli nesting.
   int intena;                  // Were interrupts enabled before pushcli?
   struct proc *proc;           // The process running on this cpu or null
+  /*------------------------- my changes starts -----------------------------*/
+  pde_t * volatile pgdir;      // User page table in %cr3, 0 for kpgdir. Read
+                               // by other cpus to find TLB shootdown targets
+  /*------------------------- my changes ends -----------------------------*/
 };
 
 extern struct cpu cpus[NCPU];
@@ -38,6 +42,118 @@ struct context {
 //   int priority;
 // };
 
+/*------------------------- my changes starts -----------------------------*/
+
+// where a virtual page of a process currently lives. A PAGE_ZERO page was
+// all zero when it was evicted; it has no swap slot and faults in as the
+// shared zero frame.
+enum pagestate { PAGE_UNUSED, PAGE_RESIDENT, PAGE_SWAPPED, PAGE_ZERO };
+
+// paging meta-data of one virtual page, indexed by virtual page number
+struct pageinfo {
+  enum pagestate state;
+  int swapSlot;        // slot in the swap file, -1 if none. A resident page
+                       // with a slot has a clean copy there until PTE_D is set
+  int prev;            // ring of resident pages in arrival order (vpn), -1 if none
+  int next;
+  uchar age;           // AGING: PTE_A samples, most recent in the top bit
+  uchar isImagePage;   // read from the executable, dropped on eviction until PTE_D is set
+  uint lastUse;        // WSCLOCK: runTicks when PTE_A was last seen set
+  uint checksum;       // same-page merging: contents at the previous scan
+  uchar pinCount;      // system call buffers on the page, it is not evicted while set
+};
+
+// a user buffer pinned for the current system call
+struct pinnedrange {
+  uint vAddr;
+  uint size;
+};
+
+// a loadable segment of the executable, faulted in page by page
+struct imagesegment {
+  uint vaddr;          // page aligned
+  uint memsz;
+  uint filesz;
+  uint off;            // offset of the segment in the executable
+};
+
+#define MAX_IMAGE_SEGMENTS 4
+
+// page-out activity of kswapd and of the processes themselves
+struct pageoutstats {
+  uint kswapdWakeups;   // rounds of kswapd below the low watermark
+  uint kswapdPageOuts;  // pages written out ahead of demand by kswapd
+  uint directPageOuts;  // pages evicted by an allocating or faulting process
+  uint zeroPageOuts;    // evicted pages that were all zero, nothing written
+  uint zeroPageIns;     // faults that mapped the shared zero frame
+};
+
+// activity of the same-page merging daemon
+struct ksmstats {
+  uint fullScans;       // passes over all processes
+  uint pagesScanned;    // resident pages checksummed
+  uint pagesMerged;     // pages remapped to an identical frame of a process
+  uint zeroPagesMerged; // pages of zeros remapped to the shared zero frame
+};
+
+// counters of the frame allocator, kept per cpu
+struct kallocstats {
+  uint allocs;          // frames handed out from the cache of a cpu
+  uint frees;           // frames put back into it
+  uint refills;         // batches taken from the buddy allocator
+  uint drains;          // batches given back to it
+  uint steals;          // frames taken from the cache of another cpu
+  uint lockAcquires;    // times kmem.lock was taken
+  uint lockContended;   // ... while another cpu held it
+};
+
+// free blocks of the buddy allocator
+struct buddystats {
+  uint freeBlocks[BUDDY_MAX_ORDER + 1];  // by order
+  uint freePages;
+  int largestOrder;     // of a free block, -1 if there is none
+  uint blocksInUse;     // blocks of more than one frame handed out
+};
+
+// one object cache of the slab allocator
+struct slabstats {
+  char *name;
+  uint objSize;         // in bytes, rounded up to the alignment
+  uint objsPerSlab;
+  uint slabs;           // pages taken from kalloc
+  uint objsInUse;       // objects handed out
+  uint cachedObjs;      // free objects held in the magazines of the cpus
+  uint allocs;
+  uint frees;
+  uint refills;         // half magazines taken from the slabs
+  uint flushes;         // half magazines given back to them
+};
+
+// cross-cpu TLB invalidations
+struct tlbstats {
+  uint shootdowns;      // invalidations another cpu had to take part in
+  uint ipis;            // T_TLBFLUSH interrupts sent for them
+};
+
+// activity of the compressed swap pool
+struct zswapstats {
+  uint storedPages;     // pages held compressed in the pool
+  uint storedBytes;     // their compressed size
+  uint poolPages;       // frames taken by the pool
+  uint stores;          // pages offered to the pool
+  uint loads;           // faults served from the pool instead of the disk
+  uint rejects;         // pages that did not compress well enough
+  uint poolFull;        // pages the pool had no room for
+  uint writeBacks;      // pages moved from the pool to the swap area
+};
+
+#define MAX_SWAP_SLOTS      (SWAPSIZE / 8)  // pages in the raw swap area, 8 blocks each
+#define PAGEINFOS_PER_CHUNK 32
+// a tracked process has at most MAX_PROC_PAGES pages, see setMemoryLimits()
+#define MAX_PAGEINFO_CHUNKS (MAX_PROC_PAGES / PAGEINFOS_PER_CHUNK)
+
+/*------------------------- my changes ends -----------------------------*/
+
 enum procstate { UNUSED, EMBRYO, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
 // Per-process state
@@ -55,21 +171,32 @@ struct proc {
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
   char name[16];               // Process name (debugging)
-  //Swap file. must initiate with create swap file
-  struct file *swapFile;			//page file
 
   /*------------------------- my changes starts -----------------------------*/
-  uint swapFilePages[MAX_SWAPFILE_PAGES];
-  uint physicalPages[MAX_PSYC_PAGES];  // contains virtual address, -1 means freed, -2 means about to free
+  struct pageinfo **pageInfoDir;  // chunks of pageinfo, indexed by virtual page number
+  uint maxPhysicalPages;          // resident page limit
+  uint maxTotalPages;             // process size limit in pages
 
   uint noOfPhysicalPages;
   uint noOfSwapFilePages;
   uint noOfPageFaults; 
 
-  int fifoHead;
-  int fifoTail;
+  int fifoHead;  // vpn of the oldest resident page, -1 if none
   int usedAlgorithm;
-  int nruIndex;  // the index from which page to be swapped out
+  int agingInterval;  // timer ticks between two samples of PTE_A
+  int agingTicks;     // timer ticks since the last sample
+  uint runTicks;      // timer ticks this process has been running, its virtual time
+  uint wsTau;         // WSCLOCK working set window in runTicks
+  int pagingLocked;   // paging meta-data is being changed, see acquirePagingLock()
+  int lazyAllocation; // sbrk() only reserves the pages, they are zero-filled on first touch
+  int swapReadAhead;  // pages in the following swap slots read along with a faulting page
+  uint noOfReadAheadPages;
+  struct inode *image;  // executable the image pages are read from
+  int noOfImageSegments;
+  struct imagesegment imageSegments[MAX_IMAGE_SEGMENTS];
+  struct pinnedrange pinnedRanges[MAX_PINNED_RANGES];  // unpinned when the system call returns
+  int noOfPinnedRanges;
+  uint noOfPinnedPages;
 
   /*------------------------- my changes ends -----------------------------*/
 
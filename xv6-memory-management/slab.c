@@ -0,0 +1,252 @@
+// Slab allocator for kernel objects smaller than a page. A cache hands out
+// objects of one size, carved out of kalloc'd pages (slabs) that start
+// with a struct slab header, so the slab of an object is found by rounding
+// its address down to the page. Each cpu keeps a magazine of free objects
+// of every cache; allocations and frees only go to the slabs, under the
+// lock of the cache, to refill or flush half a magazine at a time.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+
+/*------------------------- my changes starts -----------------------------*/
+
+#define SLAB_ALIGN 8
+
+struct slab {
+  struct slab *next;   // slabs of the cache with free objects
+  struct slab *prev;
+  struct kmemcache *cache;
+  uint inUse;          // objects handed out, magazines included
+  void *freelist;      // free objects, linked through their first word
+};
+
+#define SLAB_HEADER_SIZE ((sizeof(struct slab) + SLAB_ALIGN - 1) & ~(SLAB_ALIGN - 1))
+
+// free objects of a cache held by one cpu, used with interrupts off
+struct magazine {
+  int n;
+  void *objs[SLAB_MAGAZINE_SIZE];
+  uint allocs;
+  uint frees;
+  uint refills;         // half magazines taken from the slabs
+  uint flushes;         // half magazines given back to them
+};
+
+struct kmemcache {
+  struct spinlock lock;
+  char *name;
+  uint objSize;
+  uint objsPerSlab;
+  struct slab *partial; // slabs with free objects, empty ones included
+  uint slabs;
+  uint emptySlabs;
+  uint objs;            // objects taken from the slabs, magazines included
+  struct magazine mag[NCPU];
+};
+
+struct {
+  struct spinlock lock;
+  struct kmemcache caches[SLAB_MAX_CACHES];
+  int n;
+} slabtable;
+
+void
+slabinit(void)
+{
+  initlock(&slabtable.lock, "slabtable");
+}
+
+// Create a cache of objects of size bytes. The caches live as long as
+// the kernel does.
+struct kmemcache*
+kmemCacheCreate(char *name, uint size)
+{
+  struct kmemcache *c;
+
+  size = (size + SLAB_ALIGN - 1) & ~(SLAB_ALIGN - 1);
+  if(size < sizeof(void*) || size > PGSIZE - SLAB_HEADER_SIZE)
+    panic("kmemCacheCreate: size");
+
+  acquire(&slabtable.lock);
+  if(slabtable.n == SLAB_MAX_CACHES)
+    panic("kmemCacheCreate: too many caches");
+  c = &slabtable.caches[slabtable.n++];
+  release(&slabtable.lock);
+
+  initlock(&c->lock, name);
+  c->name = name;
+  c->objSize = size;
+  c->objsPerSlab = (PGSIZE - SLAB_HEADER_SIZE) / size;
+  return c;
+}
+
+static void
+linkSlab(struct kmemcache *c, struct slab *s)
+{
+  s->prev = 0;
+  s->next = c->partial;
+  if(s->next)
+    s->next->prev = s;
+  c->partial = s;
+}
+
+static void
+unlinkSlab(struct kmemcache *c, struct slab *s)
+{
+  if(s->prev)
+    s->prev->next = s->next;
+  else
+    c->partial = s->next;
+  if(s->next)
+    s->next->prev = s->prev;
+}
+
+// Take an object from the slabs, allocating a new slab if none has a free
+// object. Returns 0 if the kernel is out of memory. The caller holds c->lock.
+static void*
+allocFromSlab(struct kmemcache *c)
+{
+  struct slab *s;
+  void *obj;
+
+  if((s = c->partial) == 0){
+    if((s = (struct slab*)kalloc()) == 0)
+      return 0;
+    s->cache = c;
+    s->inUse = 0;
+    s->freelist = 0;
+    for(int i = c->objsPerSlab - 1; i >= 0; i--){
+      obj = (char*)s + SLAB_HEADER_SIZE + i * c->objSize;
+      *(void**)obj = s->freelist;
+      s->freelist = obj;
+    }
+    linkSlab(c, s);
+    c->slabs++;
+    c->emptySlabs++;
+  }
+
+  obj = s->freelist;
+  s->freelist = *(void**)obj;
+  c->objs++;
+  if(s->inUse++ == 0)
+    c->emptySlabs--;
+  if(s->inUse == c->objsPerSlab)
+    unlinkSlab(c, s);
+  return obj;
+}
+
+// Give an object back to its slab. A slab left empty is freed unless it is
+// the only empty one, so a cache that keeps allocating and freeing a single
+// object does not go to kalloc every time. The caller holds c->lock.
+static void
+freeToSlab(struct kmemcache *c, void *obj)
+{
+  struct slab *s = (struct slab*)PGROUNDDOWN((uint)obj);
+
+  if(s->cache != c)
+    panic("kmemCacheFree: wrong cache");
+
+  if(s->inUse == c->objsPerSlab)
+    linkSlab(c, s);
+  *(void**)obj = s->freelist;
+  s->freelist = obj;
+  c->objs--;
+
+  if(--s->inUse == 0){
+    if(c->emptySlabs > 0){
+      unlinkSlab(c, s);
+      c->slabs--;
+      kfree((char*)s);
+    } else {
+      c->emptySlabs++;
+    }
+  }
+}
+
+// Allocate an object of cache c. Returns 0 if the kernel is out of memory.
+void*
+kmemCacheAlloc(struct kmemcache *c)
+{
+  void *obj = 0;
+
+  pushcli();
+  struct magazine *m = &c->mag[cpuid()];
+
+  if(m->n == 0){
+    acquire(&c->lock);
+    while(m->n < SLAB_MAGAZINE_SIZE / 2 && (obj = allocFromSlab(c)) != 0)
+      m->objs[m->n++] = obj;
+    release(&c->lock);
+    m->refills++;
+  }
+  if(m->n > 0){
+    obj = m->objs[--m->n];
+    m->allocs++;
+  }
+
+  popcli();
+  return obj;
+}
+
+// Free an object returned by kmemCacheAlloc(c).
+void
+kmemCacheFree(struct kmemcache *c, void *obj)
+{
+  pushcli();
+  struct magazine *m = &c->mag[cpuid()];
+
+  if(m->n == SLAB_MAGAZINE_SIZE){
+    acquire(&c->lock);
+    while(m->n > SLAB_MAGAZINE_SIZE / 2)
+      freeToSlab(c, m->objs[--m->n]);
+    release(&c->lock);
+    m->flushes++;
+  }
+  m->objs[m->n++] = obj;
+  m->frees++;
+
+  popcli();
+}
+
+// counters of the i-th cache, -1 if there is none
+int
+getSlabStats(int i, struct slabstats *stats)
+{
+  struct kmemcache *c;
+
+  acquire(&slabtable.lock);
+  if(i < 0 || i >= slabtable.n){
+    release(&slabtable.lock);
+    return -1;
+  }
+  c = &slabtable.caches[i];
+  release(&slabtable.lock);
+
+  memset(stats, 0, sizeof(*stats));
+  stats->name = c->name;
+  stats->objSize = c->objSize;
+  stats->objsPerSlab = c->objsPerSlab;
+
+  acquire(&c->lock);
+  stats->slabs = c->slabs;
+  stats->objsInUse = c->objs;
+  release(&c->lock);
+
+  // read without disabling the other cpus, the counters are approximate
+  for(int j = 0; j < ncpu; j++){
+    stats->cachedObjs += c->mag[j].n;
+    stats->allocs += c->mag[j].allocs;
+    stats->frees += c->mag[j].frees;
+    stats->refills += c->mag[j].refills;
+    stats->flushes += c->mag[j].flushes;
+  }
+  stats->objsInUse -= stats->cachedObjs;
+
+  return 0;
+}
+
+/*------------------------- my changes ends -----------------------------*/
@@ -65,6 +65,10 @@ argptr(int n, char **pp, int size)
     return -1;
   if(size < 0 || (uint)i >= curproc->sz || (uint)i+size > curproc->sz)
     return -1;
+  // the pages of the buffer are faulted in now and stay resident until the
+  // system call returns
+  if(pinUserRange(curproc, i, size) < 0)
+    return -1;
   *pp = (char*)i;
   return 0;
 }
@@ -107,6 +111,15 @@ extern int sys_pgdir(void);
 extern int sys_procState(void);
 extern int sys_processSize(void);
 extern int sys_pageInfo(void);
+extern int sys_pageStat(void);
+extern int sys_setAgingInterval(void);
+extern int sys_setWorkingSetWindow(void);
+extern int sys_setGlobalReplacement(void);
+extern int sys_setMemoryLimits(void);
+extern int sys_setLazyAllocation(void);
+extern int sys_setSwapReadAhead(void);
+extern int sys_memStat(void);
+extern int sys_setMergeScanRate(void);
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -134,6 +147,15 @@ static int (*syscalls[])(void) = {
 [SYS_procState] sys_procState,
 [SYS_processSize] sys_processSize,
 [SYS_pageInfo] sys_pageInfo,
+[SYS_pageStat] sys_pageStat,
+[SYS_setAgingInterval] sys_setAgingInterval,
+[SYS_setWorkingSetWindow] sys_setWorkingSetWindow,
+[SYS_setGlobalReplacement] sys_setGlobalReplacement,
+[SYS_setMemoryLimits] sys_setMemoryLimits,
+[SYS_setLazyAllocation] sys_setLazyAllocation,
+[SYS_setSwapReadAhead] sys_setSwapReadAhead,
+[SYS_memStat] sys_memStat,
+[SYS_setMergeScanRate] sys_setMergeScanRate,
 };
 
 void
@@ -145,6 +167,10 @@ syscall(void)
   num = curproc->tf->eax;
   if(num > 0 && num < NELEM(syscalls) && syscalls[num]) {
     curproc->tf->eax = syscalls[num]();
+    /*------------------------- my changes starts -----------------------------*/
+    if(curproc->noOfPinnedRanges > 0)
+      unpinUserRanges(curproc);
+    /*------------------------- my changes ends -----------------------------*/
   } else {
     cprintf("%d %s: unknown sys call %d\n",
             curproc->pid, curproc->name, num);
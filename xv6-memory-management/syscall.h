@@ -24,3 +24,12 @@
 #define SYS_procState 23
 #define SYS_processSize 24
 #define SYS_pageInfo 25
+#define SYS_pageStat 26
+#define SYS_setAgingInterval 27
+#define SYS_setWorkingSetWindow 28
+#define SYS_setGlobalReplacement 29
+#define SYS_setMemoryLimits 30
+#define SYS_setLazyAllocation 31
+#define SYS_setSwapReadAhead 32
+#define SYS_memStat 33
+#define SYS_setMergeScanRate 34
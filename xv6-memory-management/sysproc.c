@@ -6,6 +6,8 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "proc.h"
+#include "pagestat.h"
+#include "memstat.h"
 
 int
 sys_fork(void)
@@ -108,23 +110,7 @@ void
 sys_procState(void){
   struct proc *p = myproc();
 
-  cprintf("\n");
-  cprintf("pid=%d, sz=%d, name=%s, head=%d, tail=%d\n", p->pid, p->sz, p->name, p->fifoHead, p->fifoTail);
-  cprintf("noOfPhysicalPages=%d, noOfSwapFilePages=%d, noOfPageFaults=%d\n", p->noOfPhysicalPages, p->noOfSwapFilePages, p->noOfPageFaults);
-
-  cprintf("\n");
-
-  cprintf("physicalPages:\t");
-  for(int i = 0; i < MAX_PSYC_PAGES; i++){
-    cprintf(" %d", p->physicalPages[i]);
-  }
-  cprintf("\n");
-
-  cprintf("swapFilePages:\t");
-  for(int i = 0; i < MAX_SWAPFILE_PAGES; i++){
-    cprintf(" %d", p->swapFilePages[i]);
-  }
-  cprintf("\n\n");
+  printProcPages(p);
 
   //return p->sz;
 }
@@ -141,21 +127,11 @@ sys_pageInfo(void){
   int num;
   argint(0, &num);
 
-  p->noOfPhysicalPages = p->sz / 4096;
-
-  uint va = 0;
-  for(int i = 0; i < p->noOfPhysicalPages; i++){
-    p->physicalPages[i] = va;
-    va += PGSIZE;
-  }
-  for(int i = p->noOfPhysicalPages; i < MAX_PSYC_PAGES; i++){
-      p->physicalPages[i] = -1;
-  }
-  for(int i = 0; i < MAX_SWAPFILE_PAGES; i++){
-    p->swapFilePages[i] = -1;
-  }
-  p->fifoHead = 0;
-  p->fifoTail = p->noOfPhysicalPages;
+  // the new algorithm starts from a fresh history; where the pages live
+  // (swap slots, zero frame, image pages) does not change
+  acquirePagingLock(p);
+  resetReplacementState(p);
+  releasePagingLock(p);
 
   if(num == 1){
     p->usedAlgorithm = FIFO;
@@ -163,10 +139,224 @@ sys_pageInfo(void){
   else if(num == 2){
     p->usedAlgorithm = NRU;
   }
-  p->nruIndex = -1;
+  else if(num == 3){
+    p->usedAlgorithm = CLOCK;
+  }
+  else if(num == 4){
+    p->usedAlgorithm = AGING;
+  }
+  else if(num == 5){
+    p->usedAlgorithm = WSCLOCK;
+  }
 
   return p->sz;    
 }
 
+// fill in the paging counters of the calling process, for testFramework
+int
+sys_pageStat(void){
+  struct proc *p = myproc();
+  struct pagestat *st;
+  struct pagestat counts;
+
+  if(argptr(0, (void*)&st, sizeof(*st)) < 0)
+    return -1;
+
+  memset(&counts, 0, sizeof(counts));
+
+  acquirePagingLock(p);
+  counts.physicalPages = p->noOfPhysicalPages;
+  for(uint va = 0; va < p->sz; va += PGSIZE){
+    struct pageinfo *page = getPageInfo(p, va);
+    if(page && page->state == PAGE_SWAPPED)
+      counts.swappedPages++;
+    if(page && page->state == PAGE_RESIDENT && page->swapSlot != -1)
+      counts.swapCachedPages++;
+    if(page && page->state == PAGE_ZERO)
+      counts.zeroPages++;
+  }
+  counts.pageFaults = p->noOfPageFaults;
+  counts.readAheadPages = p->noOfReadAheadPages;
+  releasePagingLock(p);
+
+  return copyout(p->pgdir, (uint)st, (char*)&counts, sizeof(counts));
+}
+
+
+// set the number of timer ticks between two samples of the access bits
+// used by the AGING algorithm
+int
+sys_setAgingInterval(void){
+  int interval;
+
+  if(argint(0, &interval) < 0 || interval < 1)
+    return -1;
+
+  myproc()->agingInterval = interval;
+  myproc()->agingTicks = 0;
+  return 0;
+}
+
+// set the working set window of the WSCLOCK algorithm, in ticks of
+// the run time of the process
+int
+sys_setWorkingSetWindow(void){
+  int tau;
+
+  if(argint(0, &tau) < 0 || tau < 0)
+    return -1;
+
+  myproc()->wsTau = tau;
+  return 0;
+}
+
+// turn global page replacement on (1) or off (0) for the whole system,
+// returns the previous mode
+int
+sys_setGlobalReplacement(void){
+  int mode;
+  int oldMode = globalReplacement;
+
+  if(argint(0, &mode) < 0)
+    return -1;
+
+  globalReplacement = (mode != 0);
+  return oldMode;
+}
+
+// set the resident page limit and the size limit (in pages) of the calling
+// process. Children inherit the limits. Pages above a lowered resident
+// limit are swapped out right away; if they cannot be, the old limits are
+// kept and -1 is returned.
+int
+sys_setMemoryLimits(void){
+  struct proc *p = myproc();
+  int maxPhysicalPages, maxTotalPages;
+
+  if(argint(0, &maxPhysicalPages) < 0 || argint(1, &maxTotalPages) < 0)
+    return -1;
+  if(maxPhysicalPages < 1 || maxPhysicalPages > maxTotalPages ||
+      maxTotalPages > MAX_PROC_PAGES || maxTotalPages < PGROUNDUP(p->sz) / PGSIZE)
+    return -1;
+
+  acquirePagingLock(p);
+
+  uint oldMaxPhysicalPages = p->maxPhysicalPages;
+  uint oldMaxTotalPages = p->maxTotalPages;
+
+  p->maxPhysicalPages = maxPhysicalPages;
+  p->maxTotalPages = maxTotalPages;
+
+  if(p->pid > 2 && !globalReplacement){
+    while(p->noOfPhysicalPages > p->maxPhysicalPages){
+      uint noOfPhysicalPages = p->noOfPhysicalPages;
+
+      pageOutBatchToSwapFile(p, p->noOfPhysicalPages - p->maxPhysicalPages);
+
+      // the pages left are pinned or the swap area is full
+      if(p->noOfPhysicalPages == noOfPhysicalPages){
+        p->maxPhysicalPages = oldMaxPhysicalPages;
+        p->maxTotalPages = oldMaxTotalPages;
+        releasePagingLock(p);
+        return -1;
+      }
+    }
+  }
+
+  releasePagingLock(p);
+  return 0;
+}
+
+
+// turn lazy allocation by sbrk() on (1) or off (0) for the calling process,
+// returns the previous mode
+int
+sys_setLazyAllocation(void){
+  struct proc *p = myproc();
+  int on, old;
+
+  if(argint(0, &on) < 0 || (on != 0 && on != 1))
+    return -1;
+
+  old = p->lazyAllocation;
+  p->lazyAllocation = on;
+  return old;
+}
+
+
+// set the number of pages in the following swap slots that are read along
+// with a swapped-out page on a page fault, returns the previous number
+int
+sys_setSwapReadAhead(void){
+  struct proc *p = myproc();
+  int pages, old;
+
+  if(argint(0, &pages) < 0 || pages < 0 || pages > SWAP_READAHEAD_MAX)
+    return -1;
+
+  old = p->swapReadAhead;
+  p->swapReadAhead = pages;
+  return old;
+}
+
+
+// fill in the memory counters of the whole system, for testFramework
+int
+sys_memStat(void){
+  struct memstat *st;
+  struct memstat counts;
+  struct kallocstats kallocStats;
+  struct buddystats buddyStats;
+  struct slabstats slabStats;
+
+  if(argptr(0, (void*)&st, sizeof(*st)) < 0)
+    return -1;
+
+  memset(&counts, 0, sizeof(counts));
+  counts.freePages = getNoOfFreePages();
+  counts.swapSlotsUsed = getNoOfUsedSwapSlots();
+  counts.zswapStores = zswapStats.stores;
+  counts.zswapLoads = zswapStats.loads;
+  counts.zswapRejects = zswapStats.rejects;
+  counts.mergedPages = ksmStats.pagesMerged;
+  counts.zeroPagesMerged = ksmStats.zeroPagesMerged;
+  counts.ncpu = ncpu;
+  counts.tlbShootdowns = tlbStats.shootdowns;
+  counts.kswapdWakeups = pageOutStats.kswapdWakeups;
+  counts.kswapdPageOuts = pageOutStats.kswapdPageOuts;
+  counts.directPageOuts = pageOutStats.directPageOuts;
+
+  getKallocStats(&kallocStats);
+  counts.kallocAllocs = kallocStats.allocs;
+  counts.kallocFrees = kallocStats.frees;
+
+  getBuddyStats(&buddyStats);
+  counts.buddyFreePages = buddyStats.freePages;
+  counts.buddyLargestOrder = buddyStats.largestOrder;
+  counts.buddyBlocksInUse = buddyStats.blocksInUse;
+
+  for(int i = 0; getSlabStats(i, &slabStats) == 0; i++)
+    counts.slabObjsInUse += slabStats.objsInUse;
+
+  return copyout(myproc()->pgdir, (uint)st, (char*)&counts, sizeof(counts));
+}
+
+
+// set how many resident pages ksmd scans for identical pages to merge per
+// round (0 turns it off) and the ticks between two rounds, for the whole
+// system. Returns the previous number of pages.
+int
+sys_setMergeScanRate(void){
+  int pages, interval;
+  int oldPages = ksmPagesToScan;
+
+  if(argint(0, &pages) < 0 || argint(1, &interval) < 0 || pages < 0 || interval < 1)
+    return -1;
+
+  ksmPagesToScan = pages;
+  ksmSleepTicks = interval;
+  return oldPages;
+}
+
 
 /*------------------------- my changes ends -----------------------------*/
\ No newline at end of file
@@ -2,6 +2,8 @@
 #include "stat.h"
 #include "user.h"
 #include "mmu.h"
+#include "pagestat.h"
+#include "memstat.h"
 
 
 void test2(){
@@ -38,15 +40,13 @@ void test(int sz){
     }
 }
 
-int main(int argc, char *argv[]){
-    printf(1, "starting...\n");
-
-    // 1 for FIFO, 2 for NRU
+void demo(){
+    // 1 for FIFO, 2 for NRU, 3 for CLOCK, 4 for AGING, 5 for WSCLOCK
     int sz = pageInfo(1);
     test(sz);
 
     // pageInfo(1);
-    // test2();    
+    // test2();
 
     fork();
 
@@ -56,7 +56,882 @@ int main(int argc, char *argv[]){
     //sleep(200);
 
     wait();
+}
+
+/*------------------------- my changes starts -----------------------------*/
+
+// Checks of the paging features. Each test runs in a child of its own, so
+// the limits and modes it sets do not leak into the next one, and sends
+// the number of failed checks back through a pipe.
+
+#define TEST_PAGES 20
+#define WORDS_PER_PAGE (PGSIZE / sizeof(int))
+#define IMAGE_PAGES 4
+
+int failures;
+int resultFd;  // write end of the pipe of the running test
+
+// initialized data, which exec() leaves in the executable until it is touched
+int imageData[IMAGE_PAGES * WORDS_PER_PAGE] = {
+    [0 ... IMAGE_PAGES * WORDS_PER_PAGE - 1] = 0x5a5a5a5a
+};
+
+void check(int cond, char *what){
+    if(!cond){
+        printf(1, "  FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+// the word at w of a buffer filled with seed, never 0. With samePages
+// every page gets the same contents.
+int pattern(int seed, int *w, int samePages){
+    uint offset = samePages ? (uint)w % PGSIZE : (uint)w;
+    return seed * 1000003 + offset / sizeof(int) + 1;
+}
+
+void fillPages(char *mem, int pages, int seed, int samePages){
+    int *words = (int*)mem;
+
+    for(int i = 0; i < pages * WORDS_PER_PAGE; i++){
+        words[i] = pattern(seed, &words[i], samePages);
+    }
+}
+
+int isFilled(char *mem, int pages, int seed, int samePages){
+    int *words = (int*)mem;
+
+    for(int i = 0; i < pages * WORDS_PER_PAGE; i++){
+        if(words[i] != pattern(seed, &words[i], samePages)){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int isZero(char *mem, int pages){
+    for(int i = 0; i < pages * WORDS_PER_PAGE; i++){
+        if(((int*)mem)[i] != 0){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// a fresh page aligned heap of n pages
+char* allocPages(int n){
+    sbrk(PGROUNDUP((uint)sbrk(0)) - (uint)sbrk(0));
+    return sbrk(n * PGSIZE);
+}
+
+// pages the tests of the replacement algorithms can add to the process
+// without going past the default size limit, at most TEST_PAGES
+int testPages(){
+    int pages = MAX_TOTAL_PAGES - PGROUNDUP((uint)sbrk(0)) / PGSIZE;
+    return pages < TEST_PAGES ? pages : TEST_PAGES;
+}
+
+// the process grows past the resident limit under the given algorithm
+// (1 for FIFO, 2 for NRU, ...); the pages swapped out must come back intact
+void checkAlgorithm(int algorithm){
+    struct pagestat st;
+
+    pageInfo(algorithm);
+
+    int pages = testPages();
+    char *mem = allocPages(pages);
+    check(mem != (char*)-1, "sbrk failed");
+    fillPages(mem, pages, algorithm, 0);
+
+    check(pageStat(&st) == 0, "pageStat failed");
+    check(st.physicalPages <= MAX_PSYC_PAGES, "more resident pages than MAX_PSYC_PAGES");
+    check(st.swappedPages > 0, "no page was swapped out");
+    check(isFilled(mem, pages, algorithm, 0), "data lost after swap-in");
+}
+
+void testFifo(){
+    checkAlgorithm(1);
+}
+
+void testNru(){
+    checkAlgorithm(2);
+}
+
+// CLOCK gives a referenced page a second chance: a page touched between
+// every two page faults is never the victim
+void testClock(){
+    struct pagestat before, after;
+
+    pageInfo(3);
+
+    int pages = testPages();
+    char *mem = allocPages(pages);
+    check(mem != (char*)-1, "sbrk failed");
+
+    for(int pg = 0; pg < pages; pg++){
+        fillPages(mem + pg * PGSIZE, 1, 3, 0);
+        check(isFilled(mem, 1, 3, 0), "data lost in the page in use");
+    }
+
+    pageStat(&before);
+    check(isFilled(mem, 1, 3, 0), "data lost in the page in use");
+    pageStat(&after);
+    check(after.pageFaults == before.pageFaults, "the page in use was swapped out");
+
+    check(isFilled(mem, pages, 3, 0), "data lost after swap-in");
+}
+
+void testAging(){
+    check(setAgingInterval(0) == -1, "aging interval 0 accepted");
+    check(setAgingInterval(2) == 0, "setAgingInterval(2) failed");
+    checkAlgorithm(4);
+}
+
+void testWsclock(){
+    check(setWorkingSetWindow(-1) == -1, "negative working set window accepted");
+    check(setWorkingSetWindow(5) == 0, "setWorkingSetWindow(5) failed");
+    checkAlgorithm(5);
+}
+
+// with global replacement a process is not held to MAX_PSYC_PAGES while
+// free frames are plentiful
+void testGlobalReplacement(){
+    struct pagestat st;
+
+    int oldMode = setGlobalReplacement(1);
+
+    int pages = testPages();
+    char *mem = allocPages(pages);
+    check(mem != (char*)-1, "sbrk failed");
+    fillPages(mem, pages, 6, 0);
+
+    pageStat(&st);
+    check(st.physicalPages > MAX_PSYC_PAGES, "resident pages still limited to MAX_PSYC_PAGES");
+    check(st.swappedPages == 0, "pages swapped out with free frames left");
+    check(isFilled(mem, pages, 6, 0), "data lost with global replacement");
+
+    check(setGlobalReplacement(oldMode) == 1, "setGlobalReplacement did not return the previous mode");
+}
+
+#define HOG_CHUNK 256   // pages a hog adds per sbrk()
+#define MAX_HOGS 40
+#define VICTIM_PAGES 100
+
+// Fork a process that takes memory until sbrk() fails at its size limit,
+// and keeps it until the write end of stop is closed. Its pages are never
+// touched, so global replacement drops them as zero pages instead of
+// filling the swap area. Returns once the hog is done growing.
+void startHog(int stop[2]){
+    int done[2];
+    char c = 0;
+
+    pipe(done);
+    if(fork() == 0){
+        close(stop[1]);
+        while(sbrk(HOG_CHUNK * PGSIZE) != (char*)-1)
+            ;
+        write(done[1], &c, 1);
+        read(stop[0], &c, 1);
+        exit();
+    }
+    read(done[0], &c, 1);
+    close(done[0]);
+    close(done[1]);
+}
+
+// Hogs push free memory below GLOBAL_FREE_PAGES_LOW until the global clock
+// takes pages of an idle process that is under no limit of its own. Its
+// data must come back intact.
+void testGlobalEviction(){
+    int stop[2], ask[2], answer[2];
+    int evicted = 0, filled = 0, hogs = 0;
+    char c = 0;
+
+    int oldMode = setGlobalReplacement(1);
+    check(setMemoryLimits(MAX_PSYC_PAGES, MAX_PROC_PAGES) == 0, "setMemoryLimits failed");
+
+    pipe(stop);
+    pipe(ask);
+    pipe(answer);
+
+    // the victim answers with its swapped-out pages while it is asked with
+    // 0, and whether its data is intact when asked with 1
+    if(fork() == 0){
+        struct pagestat st;
+        char *mem = allocPages(VICTIM_PAGES);
+        int n;
+
+        close(stop[1]);
+        fillPages(mem, VICTIM_PAGES, 7, 0);
+        while(read(ask[0], &c, 1) == 1 && c == 0){
+            pageStat(&st);
+            n = st.swappedPages;
+            write(answer[1], &n, sizeof(n));
+        }
+        n = isFilled(mem, VICTIM_PAGES, 7, 0);
+        write(answer[1], &n, sizeof(n));
+        exit();
+    }
+
+    c = 0;
+    write(ask[1], &c, 1);
+    read(answer[0], &evicted, sizeof(evicted));
+
+    for(; hogs < MAX_HOGS && evicted == 0; hogs++){
+        startHog(stop);
+
+        write(ask[1], &c, 1);
+        read(answer[0], &evicted, sizeof(evicted));
+    }
+    check(evicted > 0, "no page of another process evicted by the global clock");
+
+    c = 1;
+    write(ask[1], &c, 1);
+    read(answer[0], &filled, sizeof(filled));
+    check(filled, "data lost after eviction by another process");
+
+    close(stop[0]);
+    close(stop[1]);
+    for(int i = 0; i < hogs + 1; i++){
+        wait();
+    }
+
+    setGlobalReplacement(oldMode);
+}
+
+// Hogs push free memory below KSWAPD_LOW_WATERMARK; kswapd must wake up
+// and page out ahead of them.
+void testKswapd(){
+    struct memstat before, st;
+    int stop[2];
+    int hogs = 0;
+
+    int oldMode = setGlobalReplacement(1);
+    check(setMemoryLimits(MAX_PSYC_PAGES, MAX_PROC_PAGES) == 0, "setMemoryLimits failed");
+
+    pipe(stop);
+    memStat(&before);
+    st = before;
+    for(; hogs < MAX_HOGS && st.kswapdPageOuts == before.kswapdPageOuts; hogs++){
+        startHog(stop);
+        memStat(&st);
+    }
+    check(st.kswapdWakeups > before.kswapdWakeups, "kswapd not woken below the low watermark");
+    check(st.kswapdPageOuts > before.kswapdPageOuts, "no page written out by kswapd");
+
+    close(stop[0]);
+    close(stop[1]);
+    for(int i = 0; i < hogs; i++){
+        wait();
+    }
+
+    setGlobalReplacement(oldMode);
+}
+
+// fewer resident pages than the buffer forces swapping; the limits must
+// hold across page faults and the data must come back intact
+void testMemoryLimits(){
+    struct pagestat st;
+
+    check(setMemoryLimits(10, 5) == -1, "resident limit above size limit accepted");
+    check(setMemoryLimits(1, 1) == -1, "size limit below the process size accepted");
+    check(setMemoryLimits(5, 1000000) == -1, "huge size limit accepted");
+    check(setMemoryLimits(5, 100) == 0, "setMemoryLimits(5, 100) failed");
+
+    char *mem = allocPages(TEST_PAGES);
+    fillPages(mem, TEST_PAGES, 1, 0);
+
+    check(pageStat(&st) == 0, "pageStat failed");
+    check(st.physicalPages <= 5, "more resident pages than the limit");
+    check(st.swappedPages > 0, "no page was swapped out");
+
+    check(isFilled(mem, TEST_PAGES, 1, 0), "data lost after swap-in");
+    pageStat(&st);
+    check(st.physicalPages <= 5, "resident limit not kept after page faults");
+
+    // the size limit stops sbrk()
+    int pages = PGROUNDUP((uint)sbrk(0)) / PGSIZE;
+    check(setMemoryLimits(5, pages + 1) == 0, "setMemoryLimits to the process size failed");
+    check(sbrk(2 * PGSIZE) == (char*)-1, "sbrk beyond the size limit succeeded");
+}
+
+// parent and child write to the pages they share after fork() and each
+// must only see its own writes
+void testCopyOnWrite(){
+    int fds[2];
+    char ok = 0;
+
+    check(setMemoryLimits(10, 100) == 0, "setMemoryLimits(10, 100) failed");
+
+    char *mem = allocPages(TEST_PAGES);
+    fillPages(mem, TEST_PAGES, 1, 0);
+
+    pipe(fds);
+    int pid = fork();
+    if(pid == 0){
+        ok = isFilled(mem, TEST_PAGES, 1, 0);
+        fillPages(mem, TEST_PAGES, 2, 0);
+        ok = ok && isFilled(mem, TEST_PAGES, 2, 0);
+        write(fds[1], &ok, 1);
+        exit();
+    }
+
+    fillPages(mem, TEST_PAGES / 2, 3, 0);
+    check(pid > 0, "fork failed");
+    check(read(fds[0], &ok, 1) == 1 && ok, "child saw wrong data");
+    wait();
+    close(fds[0]);
+    close(fds[1]);
+
+    check(isFilled(mem, TEST_PAGES / 2, 3, 0), "parent lost its own writes");
+    // the pages the parent did not write keep the contents from before fork()
+    check(isFilled(mem + TEST_PAGES / 2 * PGSIZE, TEST_PAGES / 2, 1, 0), "parent saw the writes of the child");
+}
+
+// sbrk() only reserves the pages, each is zero-filled when first touched
+void testLazyAllocation(){
+    struct pagestat before, after;
+
+    check(setMemoryLimits(15, 100) == 0, "setMemoryLimits(15, 100) failed");
+    check(setLazyAllocation(2) == -1, "setLazyAllocation(2) accepted");
+    check(setLazyAllocation(1) == 0, "setLazyAllocation did not return the previous mode");
+
+    char *mem = allocPages(0);
+    pageStat(&before);
+    sbrk(10 * PGSIZE);
+    pageStat(&after);
+    check(after.physicalPages == before.physicalPages, "sbrk made pages resident");
+    check(after.pageFaults == before.pageFaults, "sbrk caused page faults");
+
+    check(isZero(mem, 10), "reserved pages are not zero");
+    fillPages(mem, 10, 1, 0);
+    check(isFilled(mem, 10, 1, 0), "data lost in reserved pages");
+
+    pageStat(&after);
+    check(after.pageFaults - before.pageFaults >= 10, "touching reserved pages did not fault");
+
+    check(setLazyAllocation(0) == 1, "setLazyAllocation did not return the previous mode");
+}
+
+// exec() reads a page of the program when it is first touched. The test
+// execs this program again, see checkImagePages().
+void testExecDemandPaging(){
+    char fd[2] = { '0' + resultFd, 0 };
+    char *argv[] = { "testFramework", "image", fd, 0 };
+
+    exec("/testFramework", argv);
+    check(0, "exec failed");
+}
+
+// run by "testFramework image" right after exec()
+void checkImagePages(){
+    struct pagestat before, after;
+    int pages = PGROUNDUP((uint)sbrk(0)) / PGSIZE;
+    int intact = 1;
+
+    pageStat(&before);
+    check(before.physicalPages < pages, "exec read the whole program");
+
+    // twice, the clean pages dropped on eviction are read again
+    for(int pass = 0; pass < 2; pass++){
+        for(int i = 0; i < IMAGE_PAGES * WORDS_PER_PAGE; i++){
+            if(imageData[i] != 0x5a5a5a5a){
+                intact = 0;
+            }
+        }
+    }
+    check(intact, "wrong data read from the executable");
+
+    pageStat(&after);
+    check(after.pageFaults - before.pageFaults >= IMAGE_PAGES - 1, "pages of the executable were not faulted in");
+}
+
+// a page read back from the swap area keeps its slot until it is written,
+// and a written page must not come back with its old contents
+void testSwapCache(){
+    struct pagestat st;
+
+    check(setMemoryLimits(5, 100) == 0, "setMemoryLimits(5, 100) failed");
+
+    char *mem = allocPages(TEST_PAGES);
+    fillPages(mem, TEST_PAGES, 1, 0);
+    check(isFilled(mem, TEST_PAGES, 1, 0), "data lost after swap-in");
+
+    pageStat(&st);
+    check(st.swapCachedPages > 0, "no page kept its swap slot after swap-in");
+
+    fillPages(mem, TEST_PAGES / 2, 2, 0);
+    check(isFilled(mem, TEST_PAGES / 2, 2, 0), "written pages came back with their old contents");
+    check(isFilled(mem + TEST_PAGES / 2 * PGSIZE, TEST_PAGES / 2, 1, 0), "data lost in the cached pages");
+}
+
+// pages read back in order are read ahead from the following swap slots
+void testSwapReadAhead(){
+    struct pagestat before, after;
 
+    check(setSwapReadAhead(-1) == -1, "negative read-ahead accepted");
+    check(setMemoryLimits(4, 100) == 0, "setMemoryLimits(4, 100) failed");
+
+    char *mem = allocPages(16);
+    fillPages(mem, 16, 1, 0);
+
+    // room for the pages read ahead
+    check(setMemoryLimits(40, 100) == 0, "setMemoryLimits(40, 100) failed");
+    setSwapReadAhead(4);
+
+    pageStat(&before);
+    check(isFilled(mem, 16, 1, 0), "data lost with read-ahead");
+    pageStat(&after);
+
+    check(after.readAheadPages > before.readAheadPages, "no page was read ahead");
+}
+
+// lowering the resident limit and growing past it evict many pages at once
+void testBatchPageOut(){
+    struct pagestat st;
+
+    check(setMemoryLimits(40, 100) == 0, "setMemoryLimits(40, 100) failed");
+
+    char *mem = allocPages(TEST_PAGES);
+    fillPages(mem, TEST_PAGES, 1, 0);
+
+    check(setMemoryLimits(4, 100) == 0, "setMemoryLimits(4, 100) failed");
+    pageStat(&st);
+    check(st.physicalPages <= 4, "lowered resident limit not kept");
+    check(st.swappedPages >= TEST_PAGES - 4, "pages above the lowered limit not swapped out");
+
+    char *more = allocPages(TEST_PAGES);
+    pageStat(&st);
+    check(more != (char*)-1 && st.physicalPages <= 4, "resident limit not kept by sbrk");
+
+    check(isFilled(mem, TEST_PAGES, 1, 0), "data lost after a batch page-out");
+    check(isZero(more, TEST_PAGES), "new pages not zero after a batch page-out");
+}
+
+// forked processes share the swap slots of their parent, and the slots of
+// a process are freed when it exits
+void testSwapArea(){
+    struct memstat before, st;
+    int fds[2];
+    char ok = 0;
+
+    check(setMemoryLimits(5, 100) == 0, "setMemoryLimits(5, 100) failed");
+
+    memStat(&before);
+    char *mem = allocPages(TEST_PAGES);
+    fillPages(mem, TEST_PAGES, 1, 0);
+
+    // no page is evicted from here on, so the slots in use only change
+    // with fork() and exit()
+    check(setMemoryLimits(60, 100) == 0, "setMemoryLimits(60, 100) failed");
+    memStat(&st);
+    check(st.swapSlotsUsed > before.swapSlotsUsed, "no swap slot used");
+
+    pipe(fds);
+    if(fork() == 0){
+        struct memstat child;
+        memStat(&child);
+        ok = child.swapSlotsUsed == st.swapSlotsUsed && isFilled(mem, TEST_PAGES, 1, 0);
+        write(fds[1], &ok, 1);
+        exit();
+    }
+    check(read(fds[0], &ok, 1) == 1 && ok, "fork copied the swap slots or the child saw wrong data");
+    wait();
+    close(fds[0]);
+    close(fds[1]);
+
+    memStat(&before);
+    if(fork() == 0){
+        setMemoryLimits(5, 100);
+        fillPages(allocPages(TEST_PAGES), TEST_PAGES, 2, 0);
+        exit();
+    }
+    wait();
+    memStat(&st);
+    check(st.swapSlotsUsed == before.swapSlotsUsed, "swap slots not freed on exit");
+}
+
+// a page that compresses well is kept in the compressed pool, one that
+// does not goes to the swap area on disk
+void testCompressedSwap(){
+    struct memstat before, after;
+    int intact = 1;
+
+    check(setMemoryLimits(5, 100) == 0, "setMemoryLimits(5, 100) failed");
+
+    memStat(&before);
+    char *mem = allocPages(TEST_PAGES);
+    for(int pg = 0; pg < TEST_PAGES; pg++){
+        memset(mem + pg * PGSIZE, pg + 1, PGSIZE);
+    }
+    for(int i = 0; i < TEST_PAGES * PGSIZE; i++){
+        if(mem[i] != i / PGSIZE + 1){
+            intact = 0;
+        }
+    }
+    memStat(&after);
+    check(intact, "data lost in the compressed pool");
+    check(after.zswapStores > before.zswapStores, "no page was offered to the compressed pool");
+    check(after.zswapLoads > before.zswapLoads, "no page was read from the compressed pool");
+
+    // random data, the same sequence is generated again to check it
+    memStat(&before);
+    uint seed = 12345;
+    for(int i = 0; i < TEST_PAGES * WORDS_PER_PAGE; i++){
+        seed = seed * 1103515245 + 12345;
+        ((uint*)mem)[i] = seed;
+    }
+    seed = 12345;
+    for(int i = 0; i < TEST_PAGES * WORDS_PER_PAGE; i++){
+        seed = seed * 1103515245 + 12345;
+        if(((uint*)mem)[i] != seed){
+            intact = 0;
+        }
+    }
+    memStat(&after);
+    check(intact, "data lost in the swap area");
+    check(after.zswapRejects > before.zswapRejects, "random pages were kept compressed");
+}
+
+// evicted pages of zeros need no swap slot and come back as zeros
+void testZeroPages(){
+    struct pagestat st;
+
+    check(setMemoryLimits(4, 100) == 0, "setMemoryLimits(4, 100) failed");
+
+    char *mem = allocPages(12);
+
+    pageStat(&st);
+    check(st.zeroPages > 0, "no evicted page was recorded as a zero page");
+    check(isZero(mem, 12), "zero pages did not read back as zeros");
+
+    // the shared zero frame is copied on write
+    fillPages(mem, 1, 1, 0);
+    check(isFilled(mem, 1, 1, 0), "write to a zero page lost");
+    check(isZero(mem + PGSIZE, 11), "write to a zero page changed another one");
+}
+
+// identical pages are merged by ksmd and split again when written
+void testSamePageMerging(){
+    struct memstat before, st;
+
+    check(setMergeScanRate(-1, 1) == -1, "negative scan rate accepted");
+    check(setMemoryLimits(30, 100) == 0, "setMemoryLimits(30, 100) failed");
+
+    char *mem = allocPages(3);
+    fillPages(mem, 3, 1, 1);
+
+    memStat(&before);
+    int oldPages = setMergeScanRate(64, 1);
+    for(int i = 0; i < 50; i++){
+        sleep(10);
+        memStat(&st);
+        if(st.mergedPages > before.mergedPages){
+            break;
+        }
+    }
+    setMergeScanRate(oldPages, KSM_SLEEP_TICKS);
+
+    check(st.mergedPages > before.mergedPages, "no page was merged");
+    check(isFilled(mem, 3, 1, 1), "merged pages changed");
+
+    fillPages(mem, 1, 2, 1);
+    check(isFilled(mem, 1, 2, 1), "write to a merged page lost");
+    check(isFilled(mem + PGSIZE, 2, 1, 1), "write to a merged page changed another one");
+}
+
+// pages given back by sbrk() must not stay reachable through the TLB, both
+// when they are invalidated one by one and past TLB_FLUSH_MAX_PAGES
+void testTlbInvalidation(){
+    int sizes[] = { 4, TLB_FLUSH_MAX_PAGES + 8 };
+
+    check(setMemoryLimits(100, 200) == 0, "setMemoryLimits(100, 200) failed");
+
+    for(int i = 0; i < 2; i++){
+        char *mem = allocPages(sizes[i]);
+        fillPages(mem, sizes[i], 1, 0);
+
+        sbrk(-sizes[i] * PGSIZE);
+        check(sbrk(sizes[i] * PGSIZE) == mem, "sbrk did not give the pages back");
+        check(isZero(mem, sizes[i]), "stale data after sbrk shrank and grew the process");
+    }
+}
+
+// ksmd merges the pages of a process that keeps running on another cpu,
+// which has to drop the old translations too
+void testTlbShootdown(){
+    struct memstat before, st;
+    int fds[2];
+    char ok = 1;
+
+    memStat(&before);
+    if(before.ncpu < 2){
+        printf(1, "  skipped: a single cpu\n");
+        return;
+    }
+
+    check(setMemoryLimits(60, 100) == 0, "setMemoryLimits(60, 100) failed");
+    char *mem = allocPages(TEST_PAGES);
+
+    pipe(fds);
+    int oldPages = setMergeScanRate(64, 1);
+    if(fork() == 0){
+        // a merged page is split again by the next write
+        int end = uptime() + 200;
+        while(uptime() < end){
+            fillPages(mem, TEST_PAGES, 1, 1);
+            ok = ok && isFilled(mem, TEST_PAGES, 1, 1);
+        }
+        write(fds[1], &ok, 1);
+        exit();
+    }
+    check(read(fds[0], &ok, 1) == 1 && ok, "data lost in pages merged on another cpu");
+    wait();
+    setMergeScanRate(oldPages, KSM_SLEEP_TICKS);
+    close(fds[0]);
+    close(fds[1]);
+
+    memStat(&st);
+    check(st.tlbShootdowns > before.tlbShootdowns, "no TLB shootdown");
+}
+
+// fork() no longer copies the kernel page tables
+void testSharedKernelPageTables(){
+    struct memstat before, st;
+    int fds[2];
+    char c = 0;
+
+    pipe(fds);
+    memStat(&before);
+    int pid = fork();
+    if(pid == 0){
+        read(fds[0], &c, 1);
+        exit();
+    }
+    memStat(&st);
+    write(fds[1], &c, 1);
+    wait();
+    close(fds[0]);
+    close(fds[1]);
+
+    check(pid > 0, "fork failed");
+    check((int)(before.freePages - st.freePages) < 16, "fork took too many frames");
+}
+
+// page tables of exited processes are freed even though the scheduler
+// keeps the last one loaded, and processes switching back and forth see
+// their own memory
+void testLazyPageTableSwitch(){
+    struct memstat before, st;
+    int toChild[2], toParent[2];
+
+    memStat(&before);
+    for(int i = 0; i < 20; i++){
+        if(fork() == 0){
+            exit();
+        }
+        wait();
+    }
+    memStat(&st);
+    check(st.freePages + 8 * st.ncpu >= before.freePages, "page tables of exited processes not freed");
+
+    pipe(toChild);
+    pipe(toParent);
+    if(fork() == 0){
+        for(int i = 0; i < 100; i++){
+            int n = -1;
+            read(toChild[0], &n, sizeof(n));
+            n++;
+            write(toParent[1], &n, sizeof(n));
+        }
+        exit();
+    }
+    int ok = 1;
+    for(int i = 0; i < 100; i++){
+        int n = 2 * i;
+        write(toChild[1], &n, sizeof(n));
+        if(read(toParent[0], &n, sizeof(n)) != sizeof(n) || n != 2 * i + 1){
+            ok = 0;
+        }
+    }
+    wait();
+    close(toChild[0]);
+    close(toChild[1]);
+    close(toParent[0]);
+    close(toParent[1]);
+
+    check(ok, "wrong data passed between two processes");
+}
+
+// the frames given back by a process return to the free frames, through
+// the cache of its cpu
+void testFrameCaches(){
+    struct memstat before, st;
+
+    check(setMemoryLimits(200, 300) == 0, "setMemoryLimits(200, 300) failed");
+
+    memStat(&before);
+    fillPages(allocPages(150), 150, 1, 0);
+    sbrk(-150 * PGSIZE);
+    memStat(&st);
+
+    check(st.kallocAllocs - before.kallocAllocs >= 150, "frames not counted as allocated");
+    check(st.kallocFrees - before.kallocFrees >= 150, "frames not counted as freed");
+    check(st.freePages + 8 >= before.freePages, "frames not given back");
+}
+
+// the frames of a process are taken from the buddy allocator and merged
+// back into blocks when they are given back; the caches of the cpus hold
+// at most KALLOC_CACHE_MAX frames each in between
+void testBuddyAllocator(){
+    struct memstat before, st;
+
+    check(setMemoryLimits(600, 700) == 0, "setMemoryLimits(600, 700) failed");
+
+    memStat(&before);
+    fillPages(allocPages(500), 500, 1, 0);
+    memStat(&st);
+    check((int)(before.buddyFreePages - st.buddyFreePages) >= 500 - KALLOC_CACHE_MAX,
+          "frames not taken from the buddy allocator");
+
+    sbrk(-500 * PGSIZE);
+    memStat(&st);
+    check((int)(before.buddyFreePages - st.buddyFreePages) <= KALLOC_CACHE_MAX + 8,
+          "frames not given back to the buddy allocator");
+    check(st.buddyLargestOrder == BUDDY_MAX_ORDER, "free blocks not merged again");
+}
+
+// kernel stacks are blocks of two frames from the buddy allocator
+void testKernelStacks(){
+    struct memstat before, st;
+    int fds[2];
+    char c;
+
+    check(pipe(fds) == 0, "pipe failed");
+
+    memStat(&before);
+    for(int i = 0; i < 8; i++){
+        if(fork() == 0){
+            close(fds[1]);
+            read(fds[0], &c, 1);
+            exit();
+        }
+    }
+    memStat(&st);
+    check(st.buddyBlocksInUse >= before.buddyBlocksInUse + 8, "kernel stacks not taken from the buddy allocator");
+
+    close(fds[0]);
+    close(fds[1]);
+    for(int i = 0; i < 8; i++){
+        wait();
+    }
+    memStat(&st);
+    check(st.buddyBlocksInUse == before.buddyBlocksInUse, "kernel stacks not given back to the buddy allocator");
+}
+
+// pipes are allocated from an object cache and given back to it
+void testSlabAllocator(){
+    struct memstat before, st;
+    int fds[10][2];
+
+    memStat(&before);
+    for(int i = 0; i < 10; i++){
+        check(pipe(fds[i]) == 0, "pipe failed");
+    }
+    memStat(&st);
+    check(st.slabObjsInUse >= before.slabObjsInUse + 10, "pipes not taken from an object cache");
+
+    for(int i = 0; i < 10; i++){
+        close(fds[i][0]);
+        close(fds[i][1]);
+    }
+    memStat(&st);
+    check(st.slabObjsInUse == before.slabObjsInUse, "pipes not given back to their object cache");
+}
+
+void runTest(char *name, void (*fn)(void)){
+    int fds[2];
+    int result = 1;
+
+    printf(1, "%s\n", name);
+
+    pipe(fds);
+    if(fork() == 0){
+        failures = 0;
+        resultFd = fds[1];
+        fn();
+        write(fds[1], &failures, sizeof(failures));
+        exit();
+    }
+    // a child killed by the kernel sends nothing
+    if(read(fds[0], &result, sizeof(result)) != sizeof(result)){
+        printf(1, "  FAILED: test did not finish\n");
+    }
+    wait();
+    close(fds[0]);
+    close(fds[1]);
+
+    failures += result;
+}
+
+/*------------------------- my changes ends -----------------------------*/
+
+int main(int argc, char *argv[]){
+    /*------------------------- my changes starts -----------------------------*/
+    // testExecDemandPaging() execs this program to check the pages of its image
+    if(argc > 2 && strcmp(argv[1], "image") == 0){
+        failures = 0;
+        checkImagePages();
+        write(atoi(argv[2]), &failures, sizeof(failures));
+        exit();
+    }
+    /*------------------------- my changes ends -----------------------------*/
+
+    printf(1, "starting...\n");
+
+    /*------------------------- my changes starts -----------------------------*/
+    // "testFramework demo" walks through the paging of one process
+    if(argc > 1 && strcmp(argv[1], "demo") == 0){
+        demo();
+        exit();
+    }
+
+    failures = 0;
+    runTest("FIFO", testFifo);
+    runTest("NRU", testNru);
+    runTest("CLOCK", testClock);
+    runTest("AGING", testAging);
+    runTest("WSCLOCK", testWsclock);
+    runTest("global replacement", testGlobalReplacement);
+    runTest("global eviction", testGlobalEviction);
+    runTest("kswapd", testKswapd);
+    runTest("memory limits", testMemoryLimits);
+    runTest("copy-on-write fork", testCopyOnWrite);
+    runTest("lazy allocation", testLazyAllocation);
+    runTest("demand paging of executables", testExecDemandPaging);
+    runTest("swap cache", testSwapCache);
+    runTest("swap read-ahead", testSwapReadAhead);
+    runTest("batched page-outs", testBatchPageOut);
+    runTest("swap area", testSwapArea);
+    runTest("compressed swap pool", testCompressedSwap);
+    runTest("zero pages", testZeroPages);
+    runTest("same-page merging", testSamePageMerging);
+    runTest("TLB invalidation", testTlbInvalidation);
+    runTest("TLB shootdown", testTlbShootdown);
+    runTest("shared kernel page tables", testSharedKernelPageTables);
+    runTest("lazy page table switch", testLazyPageTableSwitch);
+    runTest("per-cpu frame caches", testFrameCaches);
+    runTest("buddy allocator", testBuddyAllocator);
+    runTest("kernel stacks", testKernelStacks);
+    runTest("slab allocator", testSlabAllocator);
+
+    if(failures == 0){
+        printf(1, "all tests passed\n");
+    }
+    else{
+        printf(1, "%d checks failed\n", failures);
+    }
+    /*------------------------- my changes ends -----------------------------*/
 
     exit();
-}
\ No newline at end of file
+}
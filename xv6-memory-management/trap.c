@@ -61,6 +61,24 @@ trap(struct trapframe *tf)
       wakeup(&ticks);
       release(&tickslock);
     }
+
+    /*------------------------- my changes starts -----------------------------*/
+    // every cpu accounts run time to and samples the access bits of
+    // the process it is running
+    if(myproc() != 0 && myproc()->state == RUNNING){
+        myproc()->runTicks++;
+    }
+    // the sample takes the paging lock, it waits for the next tick while
+    // the paging meta-data is being changed
+    if(myproc() != 0 && myproc()->pid > 2 && myproc()->usedAlgorithm == AGING &&
+        ++myproc()->agingTicks >= myproc()->agingInterval &&
+        tryAcquirePagingLock(myproc())){
+        myproc()->agingTicks = 0;
+        updatePageAges(myproc());
+        releasePagingLock(myproc());
+    }
+    /*------------------------- my changes ends -----------------------------*/
+
     lapiceoi();
     break;
   case T_IRQ0 + IRQ_IDE:
@@ -78,6 +96,12 @@ trap(struct trapframe *tf)
     uartintr();
     lapiceoi();
     break;
+  /*------------------------- my changes starts -----------------------------*/
+  case T_TLBFLUSH:
+    tlbShootdownInterrupt();
+    lapiceoi();
+    break;
+  /*------------------------- my changes ends -----------------------------*/
   case T_IRQ0 + 7:
   case T_IRQ0 + IRQ_SPURIOUS:
     cprintf("cpu%d: spurious interrupt at %x:%x\n",
@@ -91,20 +115,20 @@ trap(struct trapframe *tf)
   // kernel memory from userspace or accesses to unallocated memory.
 
   case T_PGFLT: {
-	  if (myproc() != 0 && myproc()->pid > 2 && (tf->cs & 3) == 3){
-
-        void* va = (void*) rcr2();
-      
-        if(isPageMovedToSwapFile(myproc(), va)){
-            int physicalIndex = fifo_getIndexOfNewPhysicalPage(myproc());
-            if(physicalIndex == -1){
-              //cprintf("page out in trap\n");
-              pageOutToSwapFile(myproc());
-            }
-
-            if(pageInToPhysicalMemory(myproc(), PGROUNDDOWN(rcr2()))){
-                break;
-            }
+	  // a write to a page shared by fork(), also from the kernel as the
+	  // kernel writes to user memory with write protection enabled
+	  if (myproc() != 0 && (tf->err & FEC_WR) && rcr2() < KERNBASE &&
+	      isCopyOnWritePage(myproc()->pgdir, rcr2())){
+        if(copyOnWrite(myproc()->pgdir, rcr2()) == 0){
+            break;
+        }
+    }
+	  // a page in the swap area or a page reserved by a lazy sbrk(). The
+	  // kernel may fault on one too, unless it holds a spinlock and cannot
+	  // sleep until the page is read.
+	  else if (myproc() != 0 && ((tf->cs & 3) == 3 || mycpu()->ncli == 0)){
+        if(handlePageFault(myproc(), rcr2())){
+            break;
         }
     }
 		//break;
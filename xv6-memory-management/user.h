@@ -1,4 +1,6 @@
 struct stat;
+struct pagestat;
+struct memstat;
 struct rtcdate;
 
 // system calls
@@ -27,6 +29,15 @@ int pgdir(void);
 void procState(void);
 int processSize(void);
 int pageInfo(int);
+int pageStat(struct pagestat*);
+int setAgingInterval(int);
+int setWorkingSetWindow(int);
+int setGlobalReplacement(int);
+int setMemoryLimits(int, int);
+int setLazyAllocation(int);
+int setSwapReadAhead(int);
+int memStat(struct memstat*);
+int setMergeScanRate(int, int);
 
 // ulib.c
 int stat(const char*, struct stat*);
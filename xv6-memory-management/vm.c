@@ -6,10 +6,61 @@
 #include "mmu.h"
 #include "proc.h"
 #include "elf.h"
+#include "traps.h"
 
 extern char data[];  // defined by kernel.ld
 pde_t *kpgdir;  // for use in scheduler()
 
+/*------------------------- my changes starts -----------------------------*/
+// non-zero: processes are not limited to maxPhysicalPages, pages of any
+// process are evicted once free memory drops below GLOBAL_FREE_PAGES_LOW
+int globalReplacement;
+
+// page-out activity, printed by procState()
+struct pageoutstats pageOutStats;
+
+// frame of zeros mapped read-only copy-on-write at every PAGE_ZERO page
+// that is touched again. The kernel keeps a reference of its own, so the
+// frame is never freed and copyOnWrite() always copies it.
+char *zeroFrame;
+
+// same-page merging: pages ksmd() scans per round, ticks between rounds
+int ksmPagesToScan = KSM_PAGES_TO_SCAN;
+int ksmSleepTicks = KSM_SLEEP_TICKS;
+struct ksmstats ksmStats;
+
+// merge candidates: the last page seen with each checksum
+struct ksmentry {
+  struct proc *p;
+  int pid;             // p may have exited and its slot been reused
+  uint vAddr;
+  uint checksum;
+};
+static struct ksmentry ksmTable[KSM_TABLE_SIZE];
+
+// Invalidations of several pages of one page table that change together,
+// sent at once by endTlbBatch(). Up to TLB_FLUSH_MAX_PAGES pages are
+// dropped one by one with invlpg, past that a reload of %cr3 is cheaper.
+struct tlbbatch {
+  pde_t *pgdir;
+  int n;
+  uint vAddrs[TLB_FLUSH_MAX_PAGES];
+};
+
+// The TLB shootdown in progress. Other cpus that have pgdir loaded drop
+// the pages from their TLB on the T_TLBFLUSH interrupt and clear their bit
+// in pending; the initiator waits until all bits are clear.
+struct {
+  uint locked;             // one shootdown at a time, taken with xchg
+  pde_t *pgdir;
+  int n;
+  uint vAddrs[TLB_FLUSH_MAX_PAGES];
+  volatile uint pending;   // cpus (by index in cpus[]) still to flush
+} shootdown;
+
+struct tlbstats tlbStats;
+/*------------------------- my changes ends -----------------------------*/
+
 
 // Set up CPU's kernel segment descriptors.
 // Run once on entry on each CPU.
@@ -125,11 +176,24 @@ setupkvm(void)
   if((pgdir = (pde_t*)kalloc()) == 0)
     return 0;
   memset(pgdir, 0, PGSIZE);
+
+  /*------------------------- my changes starts -----------------------------*/
+  // The kernel half never changes after boot: every page directory points
+  // at the page tables built once for kpgdir instead of building its own.
+  if(kpgdir != 0){
+    memmove(&pgdir[PDX(KERNBASE)], &kpgdir[PDX(KERNBASE)],
+            (NPDENTRIES - PDX(KERNBASE)) * sizeof(pde_t));
+    return pgdir;
+  }
+  /*------------------------- my changes ends -----------------------------*/
+
   if (P2V(PHYSTOP) > (void*)DEVSPACE)
     panic("PHYSTOP too high");
+  // the kernel mappings are the same in every address space, they are
+  // global so that switching page tables does not flush them
   for(k = kmap; k < &kmap[NELEM(kmap)]; k++)
     if(mappages(pgdir, k->virt, k->phys_end - k->phys_start,
-                (uint)k->phys_start, k->perm) < 0) {
+                (uint)k->phys_start, k->perm | PTE_G) < 0) {
       freevm(pgdir);
       return 0;
     }
@@ -145,6 +209,16 @@ kvmalloc(void)
   switchkvm();
 }
 
+/*------------------------- my changes starts -----------------------------*/
+// Let this cpu keep PTE_G entries, the kernel mappings, in its TLB when
+// %cr3 is loaded.
+void
+pgeinit(void)
+{
+  lcr4(rcr4() | CR4_PGE);
+}
+/*------------------------- my changes ends -----------------------------*/
+
 // Switch h/w page table register to the kernel-only page table,
 // for when no process is running.
 void
@@ -174,7 +248,16 @@ switchuvm(struct proc *p)
   // forbids I/O instructions (e.g., inb and outb) from user space
   mycpu()->ts.iomb = (ushort) 0xFFFF;
   ltr(SEG_TSS << 3);
-  lcr3(V2P(p->pgdir));  // switch to process's address space
+  /*------------------------- my changes starts -----------------------------*/
+  // The scheduler keeps the page table of the last process loaded, so
+  // running it again needs no %cr3 write. Otherwise the new one is
+  // published before the switch: a cpu that changes a pte after reading
+  // it shoots the entry down here, one that changed it before is seen.
+  if(mycpu()->pgdir != p->pgdir){
+    mycpu()->pgdir = p->pgdir;
+    lcr3(V2P(p->pgdir));  // switch to process's address space
+  }
+  /*------------------------- my changes ends -----------------------------*/
   popcli();
 }
 
@@ -240,22 +323,34 @@ allocuvm(pde_t *pgdir, uint oldsz, uint newsz)
   /*------------------------- my changes starts -----------------------------*/
 
   // checking if the curproc is not init(1) or sh(2)
+  struct proc *curproc = myproc();
   int newNoOfPages = PGROUNDUP(newsz) / PGSIZE;
-  if(myproc()->pid > 2 && newNoOfPages > MAX_TOTAL_PAGES){
+  if(curproc && curproc->pid > 2 && newNoOfPages > curproc->maxTotalPages){
     return 0;
   }
 
+  // exec() builds the new image in a fresh pgdir; only the live address
+  // space of the process is tracked by the paging meta-data.
+  bool isTracked = curproc && curproc->pid > 2 && curproc->pgdir == pgdir;
+
+  if(isTracked){
+    acquirePagingLock(curproc);
+  }
+
   /*------------------------- my changes ends -----------------------------*/
 
   a = PGROUNDUP(oldsz);
   for(; a < newsz; a += PGSIZE){
 
-     /*------------------------- my changes starts -----------------------------*/
-
-    if(myproc() && myproc()->pid > 2 && myproc()->noOfPhysicalPages == MAX_PSYC_PAGES && 
-          (a == PGROUNDUP(oldsz) ||(int) myproc()->physicalPages[myproc()->fifoHead] == 0)){
+    /*------------------------- my changes starts -----------------------------*/
 
-        goto skipAllocation;
+    // the pages still to be added are made room for in one batch
+    if(isTracked && isPhysicalMemoryFull(curproc) &&
+       pageOutBatchToSwapFile(curproc, (PGROUNDUP(newsz) - a) / PGSIZE) == -1){
+      cprintf("allocuvm out of swap space\n");
+      releasePagingLock(curproc);
+      deallocuvm(pgdir, newsz, oldsz);
+      return 0;
     }
 
     /*------------------------- my changes ends -----------------------------*/
@@ -263,12 +358,16 @@ allocuvm(pde_t *pgdir, uint oldsz, uint newsz)
     mem = kalloc();
     if(mem == 0){
       cprintf("allocuvm out of memory\n");
+      if(isTracked)
+        releasePagingLock(curproc);
       deallocuvm(pgdir, newsz, oldsz);
       return 0;
     }
     memset(mem, 0, PGSIZE);
     if(mappages(pgdir, (char*)a, PGSIZE, V2P(mem), PTE_W|PTE_U) < 0){
       cprintf("allocuvm out of memory (2)\n");
+      if(isTracked)
+        releasePagingLock(curproc);
       deallocuvm(pgdir, newsz, oldsz);
       kfree(mem);
       return 0;
@@ -276,38 +375,53 @@ allocuvm(pde_t *pgdir, uint oldsz, uint newsz)
 
     /*------------------------- my changes starts -----------------------------*/
 
-skipAllocation:
-    // checking if the curproc is not init(1) or sh(2)
-    if (myproc() && myproc()->pid > 2){
-      
-      if(myproc()->noOfPhysicalPages < MAX_PSYC_PAGES){
-          if(insertPageToPhysicalMemory(myproc(), a, false) == -1){
-            cprintf("allocuvm: %d/n", a);
-            goto skipAllocation;
-          }
-      }
-	    
-	    else {
-        pageOutToSwapFile(myproc());
-        if(a == PGROUNDUP(oldsz) || (myproc()->usedAlgorithm == FIFO && 
-            (int) myproc()->physicalPages[myproc()->fifoHead - 1] == 0)){
+    if(isTracked && insertPageToPhysicalMemory(curproc, a) == -1){
+      cprintf("allocuvm out of memory (3)\n");
+      releasePagingLock(curproc);
+      deallocuvm(pgdir, newsz, oldsz);
+      return 0;
+    }
 
-          cprintf("continue\n");
-          a -= 4096;
-          continue;
-        }
+    /*------------------------- my changes ends -----------------------------*/
 
-        insertPageToPhysicalMemory(myproc(), a, true);
-      }
+  }
 
-    }
+  /*------------------------- my changes starts -----------------------------*/
 
-    /*------------------------- my changes ends -----------------------------*/
+  if(isTracked){
+    releasePagingLock(curproc);
+  }
+
+  /*------------------------- my changes ends -----------------------------*/
+
+  return newsz;
+}
+
+/*------------------------- my changes starts -----------------------------*/
+
+// Lazy counterpart of allocuvm(): the pages between oldsz and newsz are only
+// reserved, handlePageFault() maps a zeroed frame when a page is first
+// touched. Returns newsz, or 0 if the process would grow over its limit.
+int
+reserveuvm(struct proc *p, uint oldsz, uint newsz)
+{
+  if(newsz >= KERNBASE){
+    return 0;
+  }
+
+  if(newsz < oldsz){
+    return oldsz;
+  }
 
+  if(p->pid > 2 && PGROUNDUP(newsz) / PGSIZE > p->maxTotalPages){
+    return 0;
   }
+
   return newsz;
 }
 
+/*------------------------- my changes ends -----------------------------*/
+
 // Deallocate user pages to bring the process size from oldsz to
 // newsz.  oldsz and newsz need not be page-aligned, nor does newsz
 // need to be less than oldsz.  oldsz can be larger than the actual
@@ -317,10 +431,22 @@ deallocuvm(pde_t *pgdir, uint oldsz, uint newsz)
 {
   pte_t *pte;
   uint a, pa;
+  struct tlbbatch batch = { pgdir, 0 };
 
   if(newsz >= oldsz)
     return oldsz;
 
+  /*------------------------- my changes starts -----------------------------*/
+
+  // checking if the curproc is not init(1) or sh(2)
+  struct proc *curproc = myproc();
+  bool isTracked = curproc && curproc->pid > 2 && curproc->pgdir == pgdir;
+
+  if(isTracked){
+    acquirePagingLock(curproc);
+  }
+
+  /*------------------------- my changes ends -----------------------------*/
 
   a = PGROUNDUP(newsz);
   for(; a  < oldsz; a += PGSIZE){
@@ -336,21 +462,38 @@ deallocuvm(pde_t *pgdir, uint oldsz, uint newsz)
 
       /*------------------------- my changes starts -----------------------------*/
 
-      // checking if the curproc is not init(1) or sh(2)
-      if (myproc() && myproc()->pid > 2){
-        
-        for (int i = 0; i < MAX_PSYC_PAGES; i++){
-          if(myproc()->physicalPages[i] == a){
-            removePageFromPhysicalMemory(myproc(), i, false);
-          }
-        }
+      if(isTracked && isPageResident(curproc, a)){
+        removePageFromPhysicalMemory(curproc, a);
+        removePageFromSwapFile(curproc, a);
       }
 
       /*------------------------- my changes ends -----------------------------*/
 
       *pte = 0;
+      addToTlbBatch(&batch, a);
+    }
+
+    /*------------------------- my changes starts -----------------------------*/
+
+    else if((*pte & PTE_PG) != 0 && isTracked){
+      removePageFromSwapFile(curproc, a);
+      *pte = 0;
     }
+
+    /*------------------------- my changes ends -----------------------------*/
+  }
+
+  /*------------------------- my changes starts -----------------------------*/
+
+  // growproc() no longer reloads %cr3, the freed pages are dropped here
+  endTlbBatch(&batch);
+
+  if(isTracked){
+    releasePagingLock(curproc);
   }
+
+  /*------------------------- my changes ends -----------------------------*/
+
   return newsz;
 }
 
@@ -364,7 +507,8 @@ freevm(pde_t *pgdir)
   if(pgdir == 0)
     panic("freevm: no pgdir");
   deallocuvm(pgdir, KERNBASE, 0);
-  for(i = 0; i < NPDENTRIES; i++){
+  // the page tables of the kernel half are shared with kpgdir
+  for(i = 0; i < PDX(KERNBASE); i++){
     if(pgdir[i] & PTE_P){
       char * v = P2V(PTE_ADDR(pgdir[i]));
       kfree(v);
@@ -384,6 +528,9 @@ clearpteu(pde_t *pgdir, char *uva)
   if(pte == 0)
     panic("clearpteu");
   *pte &= ~PTE_U;
+  /*------------------------- my changes starts -----------------------------*/
+  flushTlbPage(pgdir, (uint)uva);
+  /*------------------------- my changes ends -----------------------------*/
 }
 
 // Given a parent process's page table, create a copy
@@ -392,23 +539,29 @@ pde_t*
 copyuvm(pde_t *pgdir, uint sz)
 {
   pde_t *d;
-  pte_t *pte;
+  pte_t *pte, *npte;
   uint pa, i, flags;
-  char *mem;
+  struct tlbbatch batch = { pgdir, 0 };
 
   if((d = setupkvm()) == 0)
     return 0;
   
   for(i = 0; i < sz; i += PGSIZE){
-    if((pte = walkpgdir(pgdir, (void *) i, 0)) == 0)
-      panic("copyuvm: pte should exist");
 
     /*------------------------- my changes starts -----------------------------*/
-    if (*pte & PTE_PG){
-      // means the page is paged out. so continue
-      // updatePteFlags(myproc(), i, -1, false);
 
-      goto mapPte;
+    // a page not loaded yet is reserved in the child as well
+    if(isPageReserved(pgdir, i))
+      continue;
+
+    pte = walkpgdir(pgdir, (void *) i, 0);
+    if (*pte & PTE_PG){
+      // means the page is paged out. There is no frame to copy, the child
+      // only gets the flags; its swap slot is shared by copyPageInfo().
+      if((npte = walkpgdir(d, (void *) i, 1)) == 0)
+        goto bad;
+      *npte = PTE_FLAGS(*pte);
+      continue;
     }
 
     if(!(*pte & PTE_P)){
@@ -420,20 +573,30 @@ copyuvm(pde_t *pgdir, uint sz)
 
     /*------------------------- my changes ends -----------------------------*/ 
 
-mapPte:
     pa = PTE_ADDR(*pte);
+
+    /*------------------------- my changes starts -----------------------------*/
+
+    // the frame is shared read-only, it is copied by copyOnWrite() when
+    // either process writes to it
+    if(*pte & PTE_W){
+      *pte = (*pte & ~PTE_W) | PTE_COW;
+      addToTlbBatch(&batch, i);
+    }
     flags = PTE_FLAGS(*pte);
-    if((mem = kalloc()) == 0)
+    if(mappages(d, (void*)i, PGSIZE, pa, flags) < 0)
       goto bad;
-    memmove(mem, (char*)P2V(pa), PGSIZE);
-    if(mappages(d, (void*)i, PGSIZE, V2P(mem), flags) < 0) {
-      kfree(mem);
-      goto bad;
-    }
+    incFrameRefCount(P2V(pa));
+
+    /*------------------------- my changes ends -----------------------------*/
   }
+
+  // the parent must not keep writable entries of the shared frames in its TLB
+  endTlbBatch(&batch);
   return d;
 
 bad:
+  endTlbBatch(&batch);
   freevm(d);
   return 0;
 }
@@ -465,6 +628,15 @@ copyout(pde_t *pgdir, uint va, void *p, uint len)
   buf = (char*)p;
   while(len > 0){
     va0 = (uint)PGROUNDDOWN(va);
+
+    /*------------------------- my changes starts -----------------------------*/
+
+    // the kernel mapping does not honour a read-only copy-on-write pte
+    if(isCopyOnWritePage(pgdir, va0) && copyOnWrite(pgdir, va0) != 0)
+      return -1;
+
+    /*------------------------- my changes ends -----------------------------*/
+
     pa0 = uva2ka(pgdir, (char*)va0);
     if(pa0 == 0)
       return -1;
@@ -472,6 +644,12 @@ copyout(pde_t *pgdir, uint va, void *p, uint len)
     if(n > len)
       n = len;
     memmove(pa0 + (va - va0), buf, n);
+
+    /*------------------------- my changes starts -----------------------------*/
+    // written through the kernel mapping, the cpu did not set PTE_D
+    *walkpgdir(pgdir, (char*)va0, 0) |= PTE_D;
+    /*------------------------- my changes ends -----------------------------*/
+
     len -= n;
     buf += n;
     va = va0 + PGSIZE;
@@ -490,235 +668,1327 @@ copyout(pde_t *pgdir, uint va, void *p, uint len)
 
 /*------------------------- my changes starts -----------------------------*/
 
-int fifo_getIndexOfNewPhysicalPage(struct proc *p){
-    if(p->noOfPhysicalPages == MAX_PSYC_PAGES){
-      return - 1;
+// drop n pages, or all of them past TLB_FLUSH_MAX_PAGES, from the TLB of
+// this cpu. Interrupts are off.
+static void flushLocalTlb(uint *vAddrs, int n){
+    if(n > TLB_FLUSH_MAX_PAGES){
+      lcr3(V2P(mycpu()->pgdir));
+      return;
+    }
+    for(int i = 0; i < n; i++){
+      invlpg((void*)vAddrs[i]);
     }
+}
+
+// T_TLBFLUSH: the part of the shootdown in progress for this cpu. Also
+// called by a cpu that waits to start a shootdown of its own, as its
+// interrupts are off. Interrupts are off.
+void tlbShootdownInterrupt(void){
+    uint self = 1 << cpuid();
 
-    return p->fifoTail;
+    if(shootdown.pending & self){
+      // a cpu that switched page tables since has nothing cached
+      if(mycpu()->pgdir == shootdown.pgdir){
+        flushLocalTlb(shootdown.vAddrs, shootdown.n);
+      }
+      __sync_fetch_and_and(&shootdown.pending, ~self);
+    }
 }
 
+// Make the cpus in targets drop n pages of pgdir from their TLB, and wait
+// until they did. The caller must not hold a spinlock another cpu could
+// spin on with interrupts off: that cpu would never answer.
+static void tlbShootdown(pde_t *pgdir, uint *vAddrs, int n, uint targets){
+    while(xchg(&shootdown.locked, 1) != 0){
+      tlbShootdownInterrupt();
+    }
 
-int insertPageToPhysicalMemory(struct proc *p, uint vAddr, bool isMemoryFull){
-  int index = -1;
+    shootdown.pgdir = pgdir;
+    shootdown.n = n;
+    for(int i = 0; i < n && i < TLB_FLUSH_MAX_PAGES; i++){
+      shootdown.vAddrs[i] = vAddrs[i];
+    }
+    shootdown.pending = targets;
 
-  if((isMemoryFull == true && p->usedAlgorithm == NRU) || p->nruIndex != -1){
-    index = p->nruIndex;
-  }
-  else{
-    index = fifo_getIndexOfNewPhysicalPage(p);
-  }
+    for(int i = 0; i < ncpu; i++){
+      if(targets & (1 << i)){
+        lapicipi(cpus[i].apicid, T_TLBFLUSH);
+        tlbStats.ipis++;
+      }
+    }
 
-  if(index == -1){
-      cprintf("insert index -1 failed\n");
-      return -1;
-  }
-  p->noOfPhysicalPages++;
-  p->physicalPages[index] = vAddr;
+    while(shootdown.pending != 0)
+      ;
 
-  if(isMemoryFull == false || p->usedAlgorithm == FIFO){
-    p->fifoTail = (p->fifoHead + p->noOfPhysicalPages) % MAX_PSYC_PAGES;
+    tlbStats.shootdowns++;
+    xchg(&shootdown.locked, 0);
+}
 
-    if(p->noOfPhysicalPages == MAX_PSYC_PAGES && (int) p->physicalPages[p->fifoHead] == 0){
+// Drop n changed pages of pgdir (all of them past TLB_FLUSH_MAX_PAGES) from
+// the TLB of every cpu that has pgdir loaded. Any other cpu has no entries
+// of it cached: switchuvm() reloads %cr3.
+void flushTlb(pde_t *pgdir, uint *vAddrs, int n){
+    uint targets = 0;
 
-        p->fifoHead = (p->fifoHead + 1) % MAX_PSYC_PAGES;
-        p->fifoTail = (p->fifoHead + p->noOfPhysicalPages) % MAX_PSYC_PAGES;
-    }    
-  }
+    if(n == 0){
+      return;
+    }
+
+    pushcli();
 
-  //if(p->usedAlgorithm == NRU){
-    printProcPages(myproc());
-  //}
+    if(mycpu()->pgdir == pgdir){
+      flushLocalTlb(vAddrs, n);
+    }
 
-  p->nruIndex = -1;
+    // the pte stores must be visible before the loaded page tables are read,
+    // see switchuvm()
+    __sync_synchronize();
+    for(int i = 0; i < ncpu; i++){
+      if(&cpus[i] != mycpu() && cpus[i].pgdir == pgdir){
+        targets |= 1 << i;
+      }
+    }
+    if(targets != 0){
+      tlbShootdown(pgdir, vAddrs, n, targets);
+    }
 
-  return 0;
+    popcli();
 }
 
-void removePageFromPhysicalMemory(struct proc *p, int index, bool isMemoryFull){
-    p->noOfPhysicalPages--;
-    p->physicalPages[index] = -2;
-
-    //p->fifoTail = (p->fifoHead + p->noOfPhysicalPages) % MAX_PSYC_PAGES;
+void flushTlbPage(pde_t *pgdir, uint vAddr){
+    flushTlb(pgdir, &vAddr, 1);
+}
 
-    if(p->usedAlgorithm == FIFO || isMemoryFull == false){
-        p->fifoHead = (p->fifoHead + 1) % MAX_PSYC_PAGES;
+void addToTlbBatch(struct tlbbatch *batch, uint vAddr){
+    if(batch->n < TLB_FLUSH_MAX_PAGES){
+      batch->vAddrs[batch->n] = vAddr;
     }
+    batch->n++;
 }
 
+void endTlbBatch(struct tlbbatch *batch){
+    flushTlb(batch->pgdir, batch->vAddrs, batch->n);
+    batch->n = 0;
+}
 
-void updatePteFlags(struct proc* p, uint vAddr, uint pAddr, bool isPageout){
-    pte_t *pte = walkpgdir(p->pgdir, (char*)vAddr, 0);
-
-    if(pte){
-      if(isPageout){
-          *pte = *pte & ~PTE_P;
-          *pte = *pte | PTE_PG;
+// The paging meta-data lives in chunks of PAGEINFOS_PER_CHUNK pages that
+// are allocated as the process grows; pageInfoDir points to the chunks.
+// Both come from slab caches, a small process needs only a few hundred
+// bytes instead of two whole pages.
+static struct kmemcache *pageInfoCache;
+static struct kmemcache *pageInfoDirCache;
 
-          // clear the ppn of pte
-          *pte = *pte & PTE_FLAGS(*pte);
-      }
+void pageinfoinit(void){
+    pageInfoCache = kmemCacheCreate("pageinfo", PAGEINFOS_PER_CHUNK * sizeof(struct pageinfo));
+    pageInfoDirCache = kmemCacheCreate("pageinfodir", MAX_PAGEINFO_CHUNKS * sizeof(struct pageinfo*));
+}
 
-      else{
-          *pte = *pte | (PTE_P | PTE_U | PTE_W);
-          *pte = *pte & ~PTE_PG;
+struct pageinfo* getPageInfoOfVpn(struct proc *p, uint vpn){
+    if(p->pageInfoDir == 0 || vpn >= MAX_PAGEINFO_CHUNKS * PAGEINFOS_PER_CHUNK){
+      return 0;
+    }
 
-          // store physicalAddr as ppn
-          *pte = *pte | pAddr;
-      }
+    struct pageinfo *chunk = p->pageInfoDir[vpn / PAGEINFOS_PER_CHUNK];
+    if(chunk == 0){
+      return 0;
+    }
 
-      //To refresh the TLB, refresh the rc3 register.
-      lcr3(V2P(p->pgdir));
-    } 
+    return &chunk[vpn % PAGEINFOS_PER_CHUNK];
 }
 
-int getIndexOfPhysicalPage(struct proc *p, uint vAddr){
-    for(int i = 0; i < MAX_PSYC_PAGES; i++){
-        if(p->physicalPages[i] == vAddr){
-            return i;
-        }
-    }
-    return -1;
+struct pageinfo* getPageInfo(struct proc *p, uint vAddr){
+    return getPageInfoOfVpn(p, vAddr / PGSIZE);
 }
 
+// like getPageInfo(), but allocates the meta-data of the page if it does
+// not exist yet. Returns 0 if the kernel is out of memory.
+struct pageinfo* allocPageInfo(struct proc *p, uint vAddr){
+    uint vpn = vAddr / PGSIZE;
 
-void pageOutToSwapFile(struct proc *p){
-    int physicalPageIndex = -1;
-
-calcIndex:
-    if(p->usedAlgorithm == NRU){
-        physicalPageIndex = nru_getIndexOfPageToBeSwappedOut(p);
+    if(vpn >= MAX_PAGEINFO_CHUNKS * PAGEINFOS_PER_CHUNK){
+      return 0;
     }
-    else{
-        physicalPageIndex = p->fifoHead;
+
+    if(p->pageInfoDir == 0){
+      if((p->pageInfoDir = (struct pageinfo**) kmemCacheAlloc(pageInfoDirCache)) == 0){
+        return 0;
+      }
+      memset(p->pageInfoDir, 0, MAX_PAGEINFO_CHUNKS * sizeof(struct pageinfo*));
     }
 
-    cprintf("page out: index = %d, %d\n", physicalPageIndex, p->physicalPages[physicalPageIndex]);
+    struct pageinfo **chunk = &p->pageInfoDir[vpn / PAGEINFOS_PER_CHUNK];
+    if(*chunk == 0){
+      if((*chunk = (struct pageinfo*) kmemCacheAlloc(pageInfoCache)) == 0){
+        return 0;
+      }
+      for(int i = 0; i < PAGEINFOS_PER_CHUNK; i++){
+        (*chunk)[i].state = PAGE_UNUSED;
+        (*chunk)[i].swapSlot = -1;
+        (*chunk)[i].prev = -1;
+        (*chunk)[i].next = -1;
+        (*chunk)[i].isImagePage = 0;
+        (*chunk)[i].checksum = 0;
+        (*chunk)[i].pinCount = 0;
+      }
+    }
 
-    pte_t *pte = walkpgdir(p->pgdir, (char*)p->physicalPages[physicalPageIndex], 0);
-    uint pAddr = PTE_ADDR(*pte);
+    return &(*chunk)[vpn % PAGEINFOS_PER_CHUNK];
+}
 
-    if(!(*pte & PTE_P) || !(*pte & PTE_U)){
-        cprintf("pid=%d, present bit=%d, user bit=%d\n", p->pid, (*pte & PTE_P), (*pte & PTE_U));
-        if(p->usedAlgorithm == FIFO){
-            p->fifoHead = (p->fifoHead + 1) % MAX_PSYC_PAGES;
-            p->fifoTail = (p->fifoHead + p->noOfPhysicalPages) % MAX_PSYC_PAGES;            
-        
-            goto calcIndex;
+// free all paging meta-data of p, the swap slots of its pages included
+void freePageInfo(struct proc *p){
+    if(p->pageInfoDir != 0){
+      for(int i = 0; i < MAX_PAGEINFO_CHUNKS; i++){
+        if(p->pageInfoDir[i] != 0){
+          for(int j = 0; j < PAGEINFOS_PER_CHUNK; j++){
+            if(p->pageInfoDir[i][j].swapSlot != -1){
+              releaseSwapSlot(p->pageInfoDir[i][j].swapSlot);
+            }
+          }
+          kmemCacheFree(pageInfoCache, p->pageInfoDir[i]);
         }
+      }
+      kmemCacheFree(pageInfoDirCache, p->pageInfoDir);
+      p->pageInfoDir = 0;
     }
+}
 
-    // cprintf("present bit=%d, user bit=%d\n", (*pte & PTE_P), (*pte & PTE_U));
-
-    // write the contents in swapfile and update swapFiles[i], physicalPages[i]
-    int fetched = fetchPhysicalPageToSwapPage(p, physicalPageIndex, p->physicalPages[physicalPageIndex]);
+// give the child a copy of the paging meta-data of the parent, the swap
+// slots are shared by reference. Returns -1 if the kernel is out of memory.
+int copyPageInfo(struct proc *parent, struct proc *child){
+    if(parent->pageInfoDir == 0){
+      return 0;
+    }
 
-    if(fetched == -1){
-      cprintf("page out: Fetching failed\n");
+    for(int i = 0; i < MAX_PAGEINFO_CHUNKS; i++){
+      if(parent->pageInfoDir[i] == 0){
+        continue;
+      }
+      if(allocPageInfo(child, i * PAGEINFOS_PER_CHUNK * PGSIZE) == 0){
+        return -1;
+      }
+      memmove(child->pageInfoDir[i], parent->pageInfoDir[i], PAGEINFOS_PER_CHUNK * sizeof(struct pageinfo));
+      for(int j = 0; j < PAGEINFOS_PER_CHUNK; j++){
+        if(child->pageInfoDir[i][j].swapSlot != -1){
+          dupSwapSlot(child->pageInfoDir[i][j].swapSlot);
+        }
+      }
     }
 
-    // free physical memory
-    char *va = (char*) P2V(pAddr);
-    kfree(va);
+    return 0;
+}
 
-    // update pte flags
-    updatePteFlags(p, p->physicalPages[physicalPageIndex], -1, true);
+bool isPageResident(struct proc *p, uint vAddr){
+    struct pageinfo *page = getPageInfo(p, vAddr);
 
-    // remove physical pages
-    removePageFromPhysicalMemory(p, physicalPageIndex, true);
+    return page != 0 && page->state == PAGE_RESIDENT;
 }
 
+bool isPhysicalMemoryFull(struct proc *p){
+    if(globalReplacement){
+        return getNoOfFreePages() < GLOBAL_FREE_PAGES_LOW;
+    }
 
-bool pageInToPhysicalMemory(struct proc *p, uint vAddr){
-    // page fault
-    p->noOfPageFaults++;
-
-    // get physical page index
-    int physicalIndex = -1;
+    return p->noOfPhysicalPages >= p->maxPhysicalPages;
+}
 
-    if(p->usedAlgorithm == FIFO){
-        physicalIndex = fifo_getIndexOfNewPhysicalPage(p);
-    }
-    else if(p->usedAlgorithm == NRU){
-        physicalIndex = p->nruIndex;
-    }
 
-    cprintf("from trap: %d, %d\n", vAddr, physicalIndex);
+// the new page becomes the youngest one, i.e. it is linked just behind fifoHead
+int insertPageToPhysicalMemory(struct proc *p, uint vAddr){
+  struct pageinfo *page = allocPageInfo(p, vAddr);
+  int vpn = vAddr / PGSIZE;
 
-    // fetch page from swap file and update swapFiles[i]
-    char buffer[PGSIZE];
-    int fetched = fetchSwapPageToPhysicalPage(p, physicalIndex, vAddr, buffer);
+  if(page == 0 || page->state == PAGE_RESIDENT){
+      cprintf("insert failed: va = %d\n", vAddr);
+      return -1;
+  }
 
-    if(fetched == -1){
-      cprintf("Fetching failed\n");
-    }
+  if(p->fifoHead == -1){
+    page->prev = vpn;
+    page->next = vpn;
+    p->fifoHead = vpn;
+  }
+  else{
+    struct pageinfo *head = getPageInfoOfVpn(p, p->fifoHead);
 
-    // kalloc returns virtual address.
-    char* newMemory = kalloc();
+    page->prev = head->prev;
+    page->next = p->fifoHead;
+    getPageInfoOfVpn(p, head->prev)->next = vpn;
+    head->prev = vpn;
+  }
 
-    // copy page contents to physical location
-    memmove(newMemory, buffer, PGSIZE);  
+  // record the owner of the frame for global replacement
+  pte_t *pte = walkpgdir(p->pgdir, (char*)vAddr, 0);
+  if(pte && (*pte & PTE_P) && P2V(PTE_ADDR(*pte)) != zeroFrame){
+    setFrameOwner(P2V(PTE_ADDR(*pte)), p, vAddr);
+  }
 
-    // update pte flags
-    uint pAddr = V2P(newMemory);
-    updatePteFlags(p, vAddr, pAddr, false);
+  page->state = PAGE_RESIDENT;
+  // a new page counts as just used so the next sample does not evict it
+  page->age = 0x80;
+  page->lastUse = p->runTicks;
+  p->noOfPhysicalPages++;
 
-    // insert page and update physicalPages[i]
-    int isInserted = insertPageToPhysicalMemory(p, vAddr, true);
-    if(isInserted == -1){
-      cprintf("invalid: size = %d, va = %d\n", p->noOfPhysicalPages, vAddr);
-      return false;
-    } 
+  if(isFreeMemoryLow()){
+    wakeupkswapd();
+  }
 
-    return true;            
+  return 0;
 }
 
+// Forget the replacement history of p: the resident ring is rebuilt in
+// address order and every resident page counts as just used.
+void resetReplacementState(struct proc *p){
+    int last = -1;
 
-bool isPageWrittable(struct proc *p, void* vAddr){
-    pte_t* pte = walkpgdir(p->pgdir, vAddr, 0);
+    p->fifoHead = -1;
 
-    if(pte){
-        if(*pte & PTE_W){
-            return true;
-        }
+    for(uint vpn = 0; vpn < PGROUNDUP(p->sz) / PGSIZE; vpn++){
+      struct pageinfo *page = getPageInfoOfVpn(p, vpn);
+
+      if(page == 0 || page->state != PAGE_RESIDENT){
+        continue;
+      }
+
+      page->age = 0x80;
+      page->lastUse = p->runTicks;
+
+      if(last == -1){
+        p->fifoHead = vpn;
+      }
+      else{
+        getPageInfoOfVpn(p, last)->next = vpn;
+      }
+      page->prev = last;
+      last = vpn;
     }
 
-    return false;
+    // close the ring
+    if(last != -1){
+      getPageInfoOfVpn(p, last)->next = p->fifoHead;
+      getPageInfoOfVpn(p, p->fifoHead)->prev = last;
+    }
 }
 
-bool updateWritePermission(struct proc *p, void* vAddr){
-    pte_t* pte = walkpgdir(p->pgdir, vAddr, 0);
+void removePageFromPhysicalMemory(struct proc *p, uint vAddr){
+    struct pageinfo *page = getPageInfo(p, vAddr);
+    int vpn = vAddr / PGSIZE;
 
-    if(pte){
-        *pte = *pte | PTE_W;
-        return true;
+    if(page == 0 || page->state != PAGE_RESIDENT){
+      return;
     }
-    return false;
-}
 
-bool isPageMovedToSwapFile(struct proc *p, void* vAddr){
-    pte_t* pte = walkpgdir(p->pgdir, vAddr, 0);
+    if(page->next == vpn){
+      p->fifoHead = -1;
+    }
+    else{
+      getPageInfoOfVpn(p, page->prev)->next = page->next;
+      getPageInfoOfVpn(p, page->next)->prev = page->prev;
 
-    if(pte){
-        if(*pte & PTE_PG){
-            return true;
-        }
+      if(p->fifoHead == vpn){
+        p->fifoHead = page->next;
+      }
     }
 
-    return false;
+    page->state = PAGE_UNUSED;
+    page->prev = -1;
+    page->next = -1;
+    p->noOfPhysicalPages--;
 }
 
-int nru_getIndexOfPageToBeSwappedOut(struct proc *p){
-    int index = -1;
-    int priority = 3;    
 
-    for(int i = 0; i < MAX_PSYC_PAGES; i++){
-      uint vAddr = p->physicalPages[i];
-      pte_t* pte = walkpgdir(p->pgdir, (char*)vAddr, 0);
+void updatePteFlags(struct proc* p, uint vAddr, uint pAddr, bool isPageout){
+    pte_t *pte = walkpgdir(p->pgdir, (char*)vAddr, 0);
+
+    if(pte){
+      if(isPageout){
+          *pte = *pte & ~PTE_P;
+          *pte = *pte | PTE_PG;
+
+          // clear the ppn of pte
+          *pte = *pte & PTE_FLAGS(*pte);
+      }
+
+      else{
+          // the frame is private, a page that was shared before it was
+          // swapped out is writable again. It is clean: it matches the copy
+          // in its swap slot.
+          *pte = *pte | (PTE_P | PTE_U | PTE_W);
+          *pte = *pte & ~(PTE_PG | PTE_COW | PTE_D);
+
+          // store physicalAddr as ppn
+          *pte = *pte | pAddr;
+      }
+
+      // only this page changed, its entry alone is dropped from the TLB
+      flushTlbPage(p->pgdir, vAddr);
+    } 
+}
+
+
+int fifo_getPageToBeSwappedOut(struct proc *p){
+    // pages without PTE_U (the guard page below the user stack) and pinned
+    // pages are never swapped out; moving the head past them rotates them
+    // to the tail.
+    for(int i = 0; i < p->noOfPhysicalPages; i++){
+      int vpn = p->fifoHead;
+      pte_t* pte = walkpgdir(p->pgdir, (char*)(vpn * PGSIZE), 0);
+
+      if((*pte & PTE_P) && (*pte & PTE_U) && !isPagePinned(p, vpn)){
+        return vpn;
+      }
+
+      cprintf("pid=%d, present bit=%d, user bit=%d\n", p->pid, (*pte & PTE_P), (*pte & PTE_U));
+      p->fifoHead = getPageInfoOfVpn(p, vpn)->next;
+    }
+
+    return -1;
+}
+
+
+// second chance: fifoHead is the clock hand. A referenced page gets its
+// PTE_A cleared and the hand moves on; the first unreferenced page is the
+// victim. Pages are inserted just behind the hand, so after a full sweep
+// the hand is back at a page whose PTE_A it has cleared.
+int clock_getPageToBeSwappedOut(struct proc *p){
+    struct tlbbatch batch = { p->pgdir, 0 };
+    int victim = -1;
+
+    for(int i = 0; i < 2 * p->noOfPhysicalPages; i++){
+      int vpn = p->fifoHead;
+      pte_t* pte = walkpgdir(p->pgdir, (char*)(vpn * PGSIZE), 0);
+
+      if((*pte & PTE_P) && (*pte & PTE_U) && !isPagePinned(p, vpn)){
+        if(!(*pte & PTE_A)){
+          victim = vpn;
+          break;
+        }
+        // the cached translation must be dropped so the cpu sets PTE_A again
+        *pte = *pte & ~PTE_A;
+        addToTlbBatch(&batch, vpn * PGSIZE);
+      }
+
+      p->fifoHead = getPageInfoOfVpn(p, vpn)->next;
+    }
+
+    endTlbBatch(&batch);
+    return victim;
+}
+
+
+// evict the resident page with the lowest age counter, the oldest one on a tie
+int aging_getPageToBeSwappedOut(struct proc *p){
+    int index = -1;
+    int lowestAge = 0x100;
+
+    int vpn = p->fifoHead;
+    for(int i = 0; i < p->noOfPhysicalPages; i++, vpn = getPageInfoOfVpn(p, vpn)->next){
+      pte_t* pte = walkpgdir(p->pgdir, (char*)(vpn * PGSIZE), 0);
+
+      if(!(*pte & PTE_P) || !(*pte & PTE_U) || isPagePinned(p, vpn)){
+        continue;
+      }
+
+      struct pageinfo *page = getPageInfoOfVpn(p, vpn);
+      if(page->age < lowestAge){
+        index = vpn;
+        lowestAge = page->age;
+      }
+    }
+
+    return index;
+}
+
+
+// WSClock: the hand sweeps the resident ring like CLOCK, but a page is only
+// evicted when it is clean and has not been used for more than wsTau ticks
+// of the process's run time. An old dirty page is written back to its swap
+// slot instead, so it is clean when the hand comes around again. If every
+// page is inside the working set the least recently used one is evicted.
+int wsclock_getPageToBeSwappedOut(struct proc *p){
+    struct tlbbatch batch = { p->pgdir, 0 };
+    int writeBacks = 0;
+    int oldest = -1;
+
+    for(int i = 0; i < 2 * p->noOfPhysicalPages; i++){
+      int vpn = p->fifoHead;
+      struct pageinfo *page = getPageInfoOfVpn(p, vpn);
+      pte_t* pte = walkpgdir(p->pgdir, (char*)(vpn * PGSIZE), 0);
+
+      if((*pte & PTE_P) && (*pte & PTE_U) && !isPagePinned(p, vpn)){
+        if(*pte & PTE_A){
+          page->lastUse = p->runTicks;
+          *pte = *pte & ~PTE_A;
+          addToTlbBatch(&batch, vpn * PGSIZE);
+        }
+        else if(p->runTicks - page->lastUse > p->wsTau){
+          if(!(*pte & PTE_D)){
+            endTlbBatch(&batch);
+            return vpn;
+          }
+
+          if(writeBacks < WSCLOCK_MAX_WRITEBACKS){
+            writeBackPage(p, vpn * PGSIZE);
+            writeBacks++;
+          }
+        }
+
+        if(oldest == -1 || getPageInfoOfVpn(p, oldest)->lastUse > page->lastUse){
+          oldest = vpn;
+        }
+      }
+
+      p->fifoHead = page->next;
+    }
+
+    endTlbBatch(&batch);
+
+    if(oldest != -1){
+      p->fifoHead = oldest;
+    }
+
+    return oldest;
+}
+
+// copy a dirty resident page to its swap slot and mark it clean. PTE_D is
+// cleared and the cached translation dropped before the copy, so a write
+// that lands during or after it sets PTE_D again instead of being lost.
+void writeBackPage(struct proc *p, uint vAddr){
+    pte_t *pte = walkpgdir(p->pgdir, (char*)vAddr, 0);
+
+    *pte = *pte & ~PTE_D;
+    flushTlbPage(p->pgdir, vAddr);
+
+    if(writePageToSwapSlot(p, vAddr, (char*) P2V(PTE_ADDR(*pte))) == -1){
+      cprintf("write back failed: va = %d\n", vAddr);
+      *pte = *pte | PTE_D;
+      return;
+    }
+}
+
+
+// vpn of the next victim of the replacement algorithm of p, -1 if none
+int selectPageToBeSwappedOut(struct proc *p){
+    if(p->usedAlgorithm == NRU){
+        return nru_getPageToBeSwappedOut(p);
+    }
+    else if(p->usedAlgorithm == CLOCK){
+        return clock_getPageToBeSwappedOut(p);
+    }
+    else if(p->usedAlgorithm == AGING){
+        return aging_getPageToBeSwappedOut(p);
+    }
+    else if(p->usedAlgorithm == WSCLOCK){
+        return wsclock_getPageToBeSwappedOut(p);
+    }
+
+    return fifo_getPageToBeSwappedOut(p);
+}
+
+// Evict one page to make room for a new one. Returns -1 if no page could
+// be written because the swap area is full. With global replacement the
+// frames below the low watermark are still free, so the caller only fails
+// when kalloc() does.
+int pageOutToSwapFile(struct proc *p){
+    int vpn = -1;
+
+    pageOutStats.directPageOuts++;
+
+    if(globalReplacement){
+        if(global_pageOutToSwapFile(p) == 0){
+            return 0;
+        }
+
+        // no other process has a page to give, fall back to our own
+        if(p->noOfPhysicalPages == 0){
+            return 0;
+        }
+    }
+
+    vpn = selectPageToBeSwappedOut(p);
+
+    // every resident page is pinned by the running system call, p stays
+    // over its limit until it returns
+    if(vpn == -1 && p->noOfPinnedPages > 0){
+        return 0;
+    }
+    if(vpn == -1){
+        panic("pageOutToSwapFile: no page to swap out");
+    }
+
+    if(evictPage(p, vpn * PGSIZE) == -1 && !globalReplacement){
+        return -1;
+    }
+
+    return 0;
+}
+
+// Evict up to n pages of p chosen by its replacement algorithm. The pages
+// that must be written go to consecutive swap slots in one transaction.
+// Global replacement takes one page of any process instead. Returns -1 if
+// the swap area is full; the pages that could not be written stay resident.
+int pageOutBatchToSwapFile(struct proc *p, int n){
+    uint vAddrs[SWAP_BATCH_MAX];
+    char* frames[SWAP_BATCH_MAX];
+    int noOfFrames = 0;
+    int result = 0;
+
+    if(globalReplacement || n <= 1){
+        return pageOutToSwapFile(p);
+    }
+
+    if(n > SWAP_BATCH_MAX){
+        n = SWAP_BATCH_MAX;
+    }
+
+    for(int i = 0; i < n && p->noOfPhysicalPages > 0; i++){
+        int vpn = selectPageToBeSwappedOut(p);
+
+        if(vpn == -1){
+            break;
+        }
+
+        pageOutStats.directPageOuts++;
+
+        char *frame = unmapPage(p, vpn * PGSIZE);
+        if(frame != 0){
+            vAddrs[noOfFrames] = vpn * PGSIZE;
+            frames[noOfFrames++] = frame;
+        }
+    }
+
+    if(noOfFrames > 0 && fetchPhysicalPagesToSwapPages(p, vAddrs, frames, noOfFrames) == -1){
+        cprintf("page out: Fetching failed\n");
+    }
+
+    // free physical memory, a page that was not written keeps its frame
+    for(int i = 0; i < noOfFrames; i++){
+        if(getPageInfo(p, vAddrs[i])->state == PAGE_SWAPPED){
+            kfree(frames[i]);
+        }
+        else{
+            remapPage(p, vAddrs[i], frames[i]);
+            result = -1;
+        }
+    }
+
+    return result;
+}
+
+// First half of evicting a resident page of p: it leaves the resident ring
+// and its pte is cleared, so p faults and waits for the paging lock if it
+// touches the page while it is written. A clean page with an up to date
+// copy in the swap file or in the executable, and a page that is all zero,
+// are done with here. Returns the frame if the page still has to be
+// written, 0 otherwise.
+char* unmapPage(struct proc *p, uint vAddr){
+    pte_t *pte = walkpgdir(p->pgdir, (char*)vAddr, 0);
+    char *frame = P2V(PTE_ADDR(*pte));
+
+    // p may be running on another cpu (global replacement, kswapd). The
+    // pte is marked paged out in one step and its cached translations are
+    // dropped before PTE_D and the frame are looked at, so a later write
+    // faults and waits for the paging lock instead of being lost.
+    pte_t old = xchg(pte, (PTE_FLAGS(*pte) & ~PTE_P) | PTE_PG);
+    flushTlbPage(p->pgdir, vAddr);
+
+    // a clean page whose copy in the swap file is up to date is not written again
+    bool isCopyValid = getIndexOfPageInSwapFile(p, vAddr) != -1 && !(old & PTE_D);
+
+    // a clean page of the executable is dropped, it is read from it again
+    bool isImageCopyValid = getPageInfo(p, vAddr)->isImagePage && !(old & PTE_D);
+
+    // remove physical pages
+    removePageFromPhysicalMemory(p, vAddr);
+
+    // a page of zeros needs neither a swap slot nor a write, the fault
+    // handler maps the zero frame at it again
+    if(frame == zeroFrame || isZeroFilled(frame)){
+      removePageFromSwapFile(p, vAddr);
+      getPageInfo(p, vAddr)->state = PAGE_ZERO;
+      getPageInfo(p, vAddr)->isImagePage = 0;
+      pageOutStats.zeroPageOuts++;
+      kfree(frame);
+      return 0;
+    }
+
+    if(isImageCopyValid){
+      *pte = 0;
+      kfree(frame);
+      return 0;
+    }
+
+    if(isCopyValid){
+      getPageInfo(p, vAddr)->state = PAGE_SWAPPED;
+      kfree(frame);
+      return 0;
+    }
+
+    return frame;
+}
+
+// Undo unmapPage() for a page that could not be written: the frame is
+// mapped again, dirty, and the page becomes the youngest resident one.
+void remapPage(struct proc *p, uint vAddr, char *frame){
+    pte_t *pte = walkpgdir(p->pgdir, (char*)vAddr, 0);
+
+    *pte = V2P(frame) | (PTE_FLAGS(*pte) & ~PTE_PG) | PTE_P | PTE_D;
+    insertPageToPhysicalMemory(p, vAddr);
+}
+
+// Move a resident page of p to its swap file. The caller holds the paging
+// lock of p. Returns -1 if the swap area is full, the page stays resident.
+int evictPage(struct proc *p, uint vAddr){
+    char *frame = unmapPage(p, vAddr);
+
+    if(frame == 0){
+      return 0;
+    }
+
+    // write the contents in swapfile and update the paging meta-data
+    if(fetchPhysicalPageToSwapPage(p, vAddr, frame) == -1){
+      cprintf("page out: Fetching failed\n");
+      remapPage(p, vAddr, frame);
+      return -1;
+    }
+
+    // free physical memory
+    kfree(frame);
+    return 0;
+}
+
+// Global replacement: a clock hand sweeps the frame table over the frames
+// of all processes. A referenced frame gets its PTE_A cleared, the first
+// unreferenced one is evicted from its owner. curproc already holds its own
+// paging lock; owners whose lock is busy are skipped. Returns -1 if no
+// frame could be evicted, or if the swap area is full.
+int global_pageOutToSwapFile(struct proc *curproc){
+    struct proc *owner;
+    uint vAddr;
+
+    for(int i = 0; i < 2 * (PHYSTOP / PGSIZE); i++){
+      char *frame = nextFrameOfGlobalClock(&owner, &vAddr);
+
+      if(frame == 0){
+        return -1;
+      }
+      if(owner == 0 || (owner != curproc && !tryAcquirePagingLock(owner))){
+        continue;
+      }
+
+      // the frame may have changed hands before the owner was locked
+      pte_t *pte = walkpgdir(owner->pgdir, (char*)vAddr, 0);
+      // evicting a frame shared copy-on-write does not free it
+      bool isValid = isPageResident(owner, vAddr) && pte && (*pte & PTE_P) &&
+                     (*pte & PTE_U) && P2V(PTE_ADDR(*pte)) == frame &&
+                     getFrameRefCount(frame) == 1 && !isPagePinned(owner, vAddr / PGSIZE);
+      bool isEvicted = false;
+      bool isFull = false;
+
+      if(isValid){
+        if(*pte & PTE_A){
+          // the owner may be running on another cpu: PTE_A is cleared
+          // without losing a PTE_D it sets meanwhile, and its cached
+          // translation would keep PTE_A from being set again
+          __sync_fetch_and_and(pte, ~PTE_A);
+          flushTlbPage(owner->pgdir, vAddr);
+        }
+        else if(evictPage(owner, vAddr) == 0){
+          isEvicted = true;
+        }
+        else{
+          // no other frame can be written either
+          isFull = true;
+        }
+      }
+
+      if(owner != curproc){
+        releasePagingLock(owner);
+      }
+      if(isEvicted){
+        return 0;
+      }
+      if(isFull){
+        return -1;
+      }
+    }
+
+    return -1;
+}
+
+bool isFreeMemoryLow(void){
+    return globalReplacement && getNoOfFreePages() < KSWAPD_LOW_WATERMARK;
+}
+
+// One round of kswapd: evict pages of any process with the global clock
+// until the high watermark is reached. Returns -1 if no frame could be
+// evicted.
+int balanceFreeFrames(void){
+    pageOutStats.kswapdWakeups++;
+
+    while(globalReplacement && getNoOfFreePages() < KSWAPD_HIGH_WATERMARK){
+      if(global_pageOutToSwapFile(myproc()) == -1){
+        return -1;
+      }
+      pageOutStats.kswapdPageOuts++;
+    }
+
+    return 0;
+}
+
+
+// Number of pages after vAddr that are read along with it: swapped-out
+// pages in the slots right after its slot, as many as fit in free frames
+// without evicting. The frame of vAddr itself is already accounted for.
+int getNoOfReadAheadPages(struct proc *p, uint vAddr){
+    int slot = getIndexOfPageInSwapFile(p, vAddr);
+    uint room = 0;
+    int n;
+
+    if(globalReplacement){
+      if(getNoOfFreePages() > KSWAPD_LOW_WATERMARK){
+        room = getNoOfFreePages() - KSWAPD_LOW_WATERMARK;
+      }
+    }
+    else if(p->maxPhysicalPages > p->noOfPhysicalPages + 1){
+      room = p->maxPhysicalPages - p->noOfPhysicalPages - 1;
+    }
+
+    for(n = 0; n < p->swapReadAhead && n < room; n++){
+      uint va = vAddr + (n + 1) * PGSIZE;
+      struct pageinfo *page = va < p->sz ? getPageInfo(p, va) : 0;
+
+      if(page == 0 || page->state != PAGE_SWAPPED || page->swapSlot != slot + n + 1){
+        break;
+      }
+    }
+
+    return n;
+}
+
+bool pageInToPhysicalMemory(struct proc *p, uint vAddr){
+    char* frames[SWAP_READAHEAD_MAX + 1];
+    int n = 1 + getNoOfReadAheadPages(p, vAddr);
+
+    // page fault
+    p->noOfPageFaults++;
+
+    // kalloc returns virtual address. Read-ahead is cut short when the
+    // kernel runs out of memory.
+    for(int i = 0; i < n; i++){
+      if((frames[i] = kalloc()) == 0){
+        n = i;
+        break;
+      }
+    }
+    if(n == 0){
+      cprintf("page in: out of memory\n");
+      return false;
+    }
+
+    // fetch the pages from swap file straight into their frames
+    int fetched = fetchSwapPagesToPhysicalPages(p, vAddr, frames, n);
+
+    for(int i = fetched < 0 ? 0 : fetched; i < n; i++){
+      kfree(frames[i]);
+    }
+    if(fetched < 1){
+      cprintf("Fetching failed\n");
+      return false;
+    }
+
+    for(int i = 0; i < fetched; i++){
+      uint va = vAddr + i * PGSIZE;
+
+      // update pte flags
+      updatePteFlags(p, va, V2P(frames[i]), false);
+
+      // insert page into the resident ring
+      if(insertPageToPhysicalMemory(p, va) == -1){
+        cprintf("invalid: size = %d, va = %d\n", p->noOfPhysicalPages, va);
+        return false;
+      }
+
+      // a page read ahead has not been used yet, AGING evicts it first
+      if(i > 0){
+        getPageInfo(p, va)->age = 0;
+      }
+    }
+
+    p->noOfReadAheadPages += fetched - 1;
+
+    return true;            
+}
 
-      if(!(*pte & PTE_U)){
-        continue;
-      }
+
+bool isPageWrittable(struct proc *p, void* vAddr){
+    pte_t* pte = walkpgdir(p->pgdir, vAddr, 0);
+
+    if(pte){
+        if(*pte & PTE_W){
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool updateWritePermission(struct proc *p, void* vAddr){
+    pte_t* pte = walkpgdir(p->pgdir, vAddr, 0);
+
+    if(pte){
+        *pte = *pte | PTE_W;
+        return true;
+    }
+    return false;
+}
+
+bool isPageMovedToSwapFile(struct proc *p, void* vAddr){
+    struct pageinfo *page = getPageInfo(p, (uint) vAddr);
+
+    return page != 0 && page->state == PAGE_SWAPPED;
+}
+
+// a page below sz that has neither a frame nor a swap slot: it is loaded
+// on first touch by demandPage()
+bool isPageReserved(pde_t *pgdir, uint vAddr){
+    pte_t* pte = walkpgdir(pgdir, (char*)vAddr, 0);
+
+    return pte == 0 || (*pte & (PTE_P | PTE_PG)) == 0;
+}
+
+// read the part of the page at vAddr that lies in a segment of the
+// executable into mem. Returns 1 if the page belongs to the image, 0 if it
+// does not and -1 if the executable could not be read.
+int readImagePage(struct proc *p, uint vAddr, char *mem){
+    for(int i = 0; i < p->noOfImageSegments; i++){
+      struct imagesegment *seg = &p->imageSegments[i];
+
+      if(vAddr < seg->vaddr || vAddr >= seg->vaddr + seg->memsz){
+        continue;
+      }
+
+      // the bss part of the segment stays zero
+      if(vAddr < seg->vaddr + seg->filesz){
+        uint n = seg->vaddr + seg->filesz - vAddr;
+        if(n > PGSIZE)
+          n = PGSIZE;
+
+        ilock(p->image);
+        int read = readi(p->image, mem, seg->off + vAddr - seg->vaddr, n);
+        iunlock(p->image);
+
+        if(read != n){
+          return -1;
+        }
+      }
+
+      return 1;
+    }
+
+    return 0;
+}
+
+// Map a frame at a page that is reserved but not loaded yet: a page of the
+// executable is read from it, a page reserved by a lazy sbrk() is zeroed.
+// The caller holds the paging lock of p if it is tracked.
+bool demandPage(struct proc *p, uint vAddr){
+    bool isTracked = p->pid > 2;
+
+    p->noOfPageFaults++;
+
+    if(isTracked && isPhysicalMemoryFull(p) && pageOutToSwapFile(p) == -1){
+      cprintf("demand paging: out of swap space\n");
+      return false;
+    }
+
+    char *newMemory = kalloc();
+    if(newMemory == 0){
+      cprintf("demand paging: out of memory\n");
+      return false;
+    }
+    memset(newMemory, 0, PGSIZE);
+
+    int isImagePage = readImagePage(p, vAddr, newMemory);
+    if(isImagePage == -1 ||
+       mappages(p->pgdir, (char*)vAddr, PGSIZE, V2P(newMemory), PTE_W|PTE_U) < 0){
+      kfree(newMemory);
+      return false;
+    }
+
+    // the frame is released with the page when the process shrinks or exits
+    if(isTracked && insertPageToPhysicalMemory(p, vAddr) == -1){
+      return false;
+    }
+
+    if(isTracked){
+      getPageInfo(p, vAddr)->isImagePage = isImagePage;
+    }
+
+    return true;
+}
+
+// Resolve a fault on a page of p that is not present: a page in the swap
+// file is paged in, a page of the executable or a page reserved by a lazy
+// sbrk() is loaded by demandPage(). Returns false if vAddr is none of them,
+// or if memory ran out.
+bool handlePageFault(struct proc *p, uint vAddr){
+    bool isTracked = p->pid > 2;
+    bool isHandled = false;
+
+    vAddr = PGROUNDDOWN(vAddr);
+    if(vAddr >= p->sz){
+      return false;
+    }
+
+    if(isTracked){
+      acquirePagingLock(p);
+    }
+
+    // without room in the swap area for the page to be replaced, the
+    // fault is not handled and p is killed
+    if(isTracked && isPageMovedToSwapFile(p, (void*)vAddr)){
+      if(!isPhysicalMemoryFull(p) || pageOutToSwapFile(p) == 0){
+        isHandled = pageInToPhysicalMemory(p, vAddr);
+      }
+    }
+    else if(isTracked && isZeroPage(p, vAddr)){
+      if(!isPhysicalMemoryFull(p) || pageOutToSwapFile(p) == 0){
+        isHandled = mapZeroFrame(p, vAddr);
+      }
+    }
+    else if(isPageReserved(p->pgdir, vAddr)){
+      isHandled = demandPage(p, vAddr);
+    }
+
+    if(isTracked){
+      releasePagingLock(p);
+    }
+
+    return isHandled;
+}
+
+// Fault in the pages of a user buffer before a system call uses it and
+// keep them resident until it returns. Pipes and the console touch the
+// buffer while holding a spinlock, where the page fault handler could not
+// sleep on the disk or the paging lock. No replacement algorithm, kswapd
+// or other process evicts a pinned page; a process whose resident pages
+// are all pinned goes over its resident limit until unpinUserRanges().
+int pinUserRange(struct proc *p, uint vAddr, uint size){
+    bool isTracked = p->pid > 2;
+
+    if(p->noOfPinnedRanges == MAX_PINNED_RANGES){
+      return -1;
+    }
+
+    for(uint a = PGROUNDDOWN(vAddr); a < vAddr + size; a += PGSIZE){
+      for(;;){
+        pte_t* pte = walkpgdir(p->pgdir, (char*)a, 0);
+
+        if((pte == 0 || !(*pte & PTE_P)) && !handlePageFault(p, a)){
+          // the pages pinned so far are unpinned when the call returns
+          return -1;
+        }
+        if(!isTracked){
+          break;
+        }
+
+        // kswapd may have evicted the page again before it is pinned
+        acquirePagingLock(p);
+        pte = walkpgdir(p->pgdir, (char*)a, 0);
+        struct pageinfo *page = getPageInfo(p, a);
+        bool isPinned = pte && (*pte & PTE_P) && page != 0;
+        if(isPinned && page->pinCount++ == 0){
+          p->noOfPinnedPages++;
+        }
+        releasePagingLock(p);
+
+        if(isPinned){
+          break;
+        }
+      }
+
+      // record the range as far as it is pinned
+      struct pinnedrange *r = &p->pinnedRanges[p->noOfPinnedRanges];
+      if(a == PGROUNDDOWN(vAddr)){
+        r->vAddr = vAddr;
+        p->noOfPinnedRanges++;
+      }
+      r->size = a + PGSIZE - PGROUNDDOWN(vAddr);
+    }
+
+    return 0;
+}
+
+// unpin the buffers of the system call that returns, and give back the
+// pages p took over its resident limit while they were pinned
+void unpinUserRanges(struct proc *p){
+    if(p->pid <= 2){
+      p->noOfPinnedRanges = 0;
+      return;
+    }
+
+    acquirePagingLock(p);
+
+    for(int i = 0; i < p->noOfPinnedRanges; i++){
+      struct pinnedrange *r = &p->pinnedRanges[i];
+
+      for(uint a = PGROUNDDOWN(r->vAddr); a < PGROUNDDOWN(r->vAddr) + r->size; a += PGSIZE){
+        struct pageinfo *page = getPageInfo(p, a);
+
+        if(page != 0 && page->pinCount > 0 && --page->pinCount == 0){
+          p->noOfPinnedPages--;
+        }
+      }
+    }
+    p->noOfPinnedRanges = 0;
+
+    while(!globalReplacement && p->noOfPhysicalPages > p->maxPhysicalPages){
+      uint noOfPhysicalPages = p->noOfPhysicalPages;
+
+      pageOutBatchToSwapFile(p, p->noOfPhysicalPages - p->maxPhysicalPages);
+      if(p->noOfPhysicalPages == noOfPhysicalPages){
+        break;
+      }
+    }
+
+    releasePagingLock(p);
+}
+
+bool isPagePinned(struct proc *p, uint vpn){
+    struct pageinfo *page = getPageInfoOfVpn(p, vpn);
+
+    return page != 0 && page->pinCount > 0;
+}
+
+void zeroframeinit(void){
+    if((zeroFrame = kalloc()) == 0){
+      panic("zeroframeinit");
+    }
+    memset(zeroFrame, 0, PGSIZE);
+}
+
+bool isZeroFilled(char *frame){
+    uint *word = (uint*) frame;
+
+    for(int i = 0; i < PGSIZE / sizeof(uint); i++){
+      if(word[i] != 0){
+        return false;
+      }
+    }
+
+    return true;
+}
+
+bool isZeroPage(struct proc *p, uint vAddr){
+    struct pageinfo *page = getPageInfo(p, vAddr);
+
+    return page != 0 && page->state == PAGE_ZERO;
+}
+
+// Map the shared zero frame read-only at a PAGE_ZERO page of p; the first
+// write to it takes a private copy through copyOnWrite(). The page is
+// resident again, though it costs no frame until then.
+bool mapZeroFrame(struct proc *p, uint vAddr){
+    pte_t *pte = walkpgdir(p->pgdir, (char*)vAddr, 0);
+
+    p->noOfPageFaults++;
+
+    if(pte == 0){
+      return false;
+    }
+
+    // a page that could be written is copy-on-write from now on
+    if(*pte & (PTE_W | PTE_COW)){
+      *pte = *pte | PTE_COW;
+    }
+    *pte = (*pte & ~(PTE_PG | PTE_W | PTE_D)) | V2P(zeroFrame) | PTE_P | PTE_U;
+    incFrameRefCount(zeroFrame);
+
+    if(insertPageToPhysicalMemory(p, vAddr) == -1){
+      return false;
+    }
+
+    pageOutStats.zeroPageIns++;
+    flushTlbPage(p->pgdir, vAddr);
+
+    return true;
+}
+
+uint pageChecksum(char *frame){
+    uint *word = (uint*) frame;
+    uint checksum = 2166136261U;
+
+    for(int i = 0; i < PGSIZE / sizeof(uint); i++){
+      checksum = (checksum ^ word[i]) * 16777619U;
+    }
+
+    return checksum;
+}
+
+// point pte at frame, shared copy-on-write, and drop the frame it had
+static void remapToSharedFrame(pte_t *pte, char *frame){
+    char *oldFrame = P2V(PTE_ADDR(*pte));
+
+    if(*pte & PTE_W){
+      *pte = (*pte & ~PTE_W) | PTE_COW;
+    }
+    *pte = V2P(frame) | PTE_FLAGS(*pte);
+    incFrameRefCount(frame);
+    kfree(oldFrame);
+}
+
+// Same-page merging of a resident page of p, called by the scan of ksmd().
+// A page whose checksum did not change since the previous scan is merged
+// with the last page seen with the same checksum, of any process, into a
+// single read-only copy-on-write frame; a write takes a private copy again
+// through copyOnWrite(). A page of zeros is merged with the zero frame.
+// The page tables are only changed while neither process runs, so no TLB
+// holds a writable entry of a merged page. The caller holds the paging
+// lock of p.
+void mergeSamePage(struct proc *p, uint vAddr){
+    pte_t *pte = walkpgdir(p->pgdir, (char*)vAddr, 0);
+    struct pageinfo *page = getPageInfo(p, vAddr);
+
+    if(pte == 0 || !(*pte & PTE_P) || !(*pte & PTE_U) || page == 0 ||
+       P2V(PTE_ADDR(*pte)) == zeroFrame){
+      return;
+    }
+
+    ksmStats.pagesScanned++;
+
+    // a page that changed since the previous scan is too volatile to merge
+    uint checksum = pageChecksum(P2V(PTE_ADDR(*pte)));
+    if(checksum != page->checksum){
+      page->checksum = checksum;
+      return;
+    }
+
+    if(isZeroFilled(P2V(PTE_ADDR(*pte)))){
+      if(acquireProcTableIfIdle(p, p)){
+        if(isZeroFilled(P2V(PTE_ADDR(*pte)))){
+          remapToSharedFrame(pte, zeroFrame);
+          ksmStats.zeroPagesMerged++;
+        }
+        releaseProcTable();
+      }
+      return;
+    }
+
+    struct ksmentry *e = &ksmTable[checksum % KSM_TABLE_SIZE];
+    struct proc *q = e->p;
+    bool isMerged = false;
+
+    if(q != 0 && e->checksum == checksum && (q != p || e->vAddr != vAddr) &&
+       (q == p || tryAcquirePagingLock(q))){
+      if(q->pid == e->pid && e->vAddr < q->sz && acquireProcTableIfIdle(p, q)){
+        pte_t *qpte = walkpgdir(q->pgdir, (char*)e->vAddr, 0);
+
+        // compared while neither process runs, so neither page can change
+        // before it is write-protected
+        if(qpte && (*qpte & PTE_P) && (*qpte & PTE_U) &&
+           PTE_ADDR(*qpte) != PTE_ADDR(*pte) &&
+           memcmp(P2V(PTE_ADDR(*pte)), P2V(PTE_ADDR(*qpte)), PGSIZE) == 0){
+          if(*qpte & PTE_W){
+            *qpte = (*qpte & ~PTE_W) | PTE_COW;
+          }
+          remapToSharedFrame(pte, P2V(PTE_ADDR(*qpte)));
+          ksmStats.pagesMerged++;
+          isMerged = true;
+        }
+        releaseProcTable();
+      }
+      if(q != p){
+        releasePagingLock(q);
+      }
+    }
+
+    // the page becomes the candidate for its checksum
+    if(!isMerged){
+      e->p = p;
+      e->pid = p->pid;
+      e->vAddr = vAddr;
+      e->checksum = checksum;
+    }
+}
+
+bool isCopyOnWritePage(pde_t *pgdir, uint vAddr){
+    pte_t* pte = walkpgdir(pgdir, (char*)vAddr, 0);
+
+    return pte != 0 && (*pte & PTE_P) && (*pte & PTE_COW);
+}
+
+// Break the sharing of a copy-on-write page after a write fault. The last
+// process sharing the frame takes it over, the others get a private copy.
+// It runs without the paging lock, also from a kernel write fault under a
+// spinlock. An evictor on another cpu (global replacement, kswapd) may
+// change the pte meanwhile, so the new pte is only stored if the pte did
+// not change since it was read; a page that was moved out faults again.
+// Returns -1 if the kernel is out of memory.
+int copyOnWrite(pde_t *pgdir, uint vAddr){
+    pte_t* pte = walkpgdir(pgdir, (char*)vAddr, 0);
+    struct proc *p = myproc();
+    char *newMemory = 0;
+    char *frame;
+    pte_t old, new;
+
+    if(pte == 0 || !(*pte & PTE_P) || !(*pte & PTE_COW)){
+      return -1;
+    }
+
+    do{
+      old = *pte;
+      if(!(old & PTE_P) || !(old & PTE_COW)){
+        if(newMemory != 0){
+          kfree(newMemory);
+        }
+        return 0;
+      }
+
+      frame = P2V(PTE_ADDR(old));
+      new = (old | PTE_W) & ~PTE_COW;
+
+      if(getFrameRefCount(frame) > 1){
+        if(newMemory == 0 && (newMemory = kalloc()) == 0){
+          cprintf("copy on write: out of memory\n");
+          return -1;
+        }
+
+        memmove(newMemory, frame, PGSIZE);
+        new = V2P(newMemory) | PTE_FLAGS(new);
+      }
+    } while(!__sync_bool_compare_and_swap(pte, old, new));
+
+    if(PTE_ADDR(new) != PTE_ADDR(old)){
+      // drop our reference of the shared frame
+      kfree(frame);
+      frame = newMemory;
+    }
+    else if(newMemory != 0){
+      kfree(newMemory);
+    }
+
+    if(p != 0 && p->pgdir == pgdir){
+      if(isPageResident(p, PGROUNDDOWN(vAddr))){
+        setFrameOwner(frame, p, PGROUNDDOWN(vAddr));
+      }
+    }
+    flushTlbPage(pgdir, PGROUNDDOWN(vAddr));
+
+    return 0;
+}
+
+int nru_getPageToBeSwappedOut(struct proc *p){
+    int index = -1;
+    int priority = 3;    
+
+    int vpn = p->fifoHead;
+    for(int i = 0; i < p->noOfPhysicalPages; i++, vpn = getPageInfoOfVpn(p, vpn)->next){
+      pte_t* pte = walkpgdir(p->pgdir, (char*)(vpn * PGSIZE), 0);
+
+      if(!(*pte & PTE_U) || isPagePinned(p, vpn)){
+        continue;
+      }
 
       int isModified = 0;
       int isReferenced = 0;
@@ -731,36 +2001,30 @@ int nru_getIndexOfPageToBeSwappedOut(struct proc *p){
       }
 
       if(isReferenced == 0 && isModified == 0){
-          //cprintf("----------------- 0   0   0    0 ------------------------ \n");
-          index = i;
+          index = vpn;
           priority = 0;
-          //cprintf("break from for loop %d\n", i);
           break;
       }
       else if(isReferenced == 0 && isModified == 1){
           if(priority > 1){
-              //cprintf("----------------- 1    1   1   1   1 ------------------------ \n");
-              index = i;
+              index = vpn;
               priority = 1;
           }
       }
       else if(isReferenced == 1 && isModified == 0){
           if(priority > 2){
-              //cprintf("----------------- 2   2   2    2 ------------------------ \n");
-              index = i;
+              index = vpn;
               priority = 2;
           }
       }
       else{
           if(priority == 3 && index == -1){
-              //cprintf("----------------- 3   3   3    3 ------------------------ \n");
-              index = i;
+              index = vpn;
           }
       }
     }
 
-    p->nruIndex = index;
-    //cprintf("nru index=%d, priority=%d, va=%d\n", index, priority, p->physicalPages[index]);
+    //cprintf("nru vpn=%d, priority=%d\n", index, priority);
 
     return index;
 }
@@ -768,28 +2032,112 @@ int nru_getIndexOfPageToBeSwappedOut(struct proc *p){
 void printProcPages(struct proc *p){
 
     cprintf("\nphysicalPages:\t");
-    for(int i = 0; i < MAX_PSYC_PAGES; i++){
-      cprintf(" %d", p->physicalPages[i]);
+    int vpn = p->fifoHead;
+    for(int i = 0; i < p->noOfPhysicalPages; i++, vpn = getPageInfoOfVpn(p, vpn)->next){
+      cprintf(" %d", vpn * PGSIZE);
     }
     cprintf("\n");
     cprintf("swapFilePages:\t");
-    for(int i = 0; i < MAX_SWAPFILE_PAGES; i++){
-      cprintf(" %d", p->swapFilePages[i]);
+    for(uint va = 0; va < p->sz; va += PGSIZE){
+      struct pageinfo *page = getPageInfo(p, va);
+      if(page && page->state == PAGE_SWAPPED){
+        cprintf(" %d@%d", va, page->swapSlot);
+      }
     }
     cprintf("\n");
-    cprintf("pid=%d, sz=%d, name=%s, head=%d, tail=%d\n", p->pid, p->sz, p->name, p->fifoHead, p->fifoTail);
+    cprintf("zeroPages:\t");
+    for(uint va = 0; va < p->sz; va += PGSIZE){
+      struct pageinfo *page = getPageInfo(p, va);
+      if(page && page->state == PAGE_ZERO){
+        cprintf(" %d", va);
+      }
+    }
+    cprintf("\n");
+    cprintf("swapCachePages:\t");
+    for(uint va = 0; va < p->sz; va += PGSIZE){
+      struct pageinfo *page = getPageInfo(p, va);
+      if(page && page->state == PAGE_RESIDENT && page->swapSlot != -1){
+        cprintf(" %d@%d", va, page->swapSlot);
+      }
+    }
+    cprintf("\n");
+    cprintf("pid=%d, sz=%d, name=%s, head=%d\n", p->pid, p->sz, p->name, p->fifoHead);
     cprintf("noOfPhysicalPages=%d, noOfSwapFilePages=%d, noOfPageFaults=%d\n", p->noOfPhysicalPages, p->noOfSwapFilePages, p->noOfPageFaults);
+    cprintf("swapReadAhead=%d, noOfReadAheadPages=%d\n", p->swapReadAhead, p->noOfReadAheadPages);
+    cprintf("maxPhysicalPages=%d, maxTotalPages=%d\n", p->maxPhysicalPages, p->maxTotalPages);
+    cprintf("kswapdWakeups=%d, kswapdPageOuts=%d, directPageOuts=%d, freePages=%d\n",
+            pageOutStats.kswapdWakeups, pageOutStats.kswapdPageOuts,
+            pageOutStats.directPageOuts, getNoOfFreePages());
+    cprintf("zeroPageOuts=%d, zeroPageIns=%d\n",
+            pageOutStats.zeroPageOuts, pageOutStats.zeroPageIns);
+    cprintf("ksmPagesToScan=%d, ksmSleepTicks=%d, ksmFullScans=%d, ksmPagesScanned=%d, ksmPagesMerged=%d, ksmZeroPagesMerged=%d\n",
+            ksmPagesToScan, ksmSleepTicks, ksmStats.fullScans, ksmStats.pagesScanned,
+            ksmStats.pagesMerged, ksmStats.zeroPagesMerged);
+    struct kallocstats kallocStats;
+    getKallocStats(&kallocStats);
+    cprintf("kallocAllocs=%d, kallocFrees=%d, kallocRefills=%d, kallocDrains=%d, kallocSteals=%d, kmemLockAcquires=%d, kmemLockContended=%d\n",
+            kallocStats.allocs, kallocStats.frees, kallocStats.refills, kallocStats.drains,
+            kallocStats.steals, kallocStats.lockAcquires, kallocStats.lockContended);
+    struct buddystats buddyStats;
+    getBuddyStats(&buddyStats);
+    cprintf("buddyFreeBlocks:\t");
+    for(int k = 0; k <= BUDDY_MAX_ORDER; k++){
+      cprintf(" %d", buddyStats.freeBlocks[k]);
+    }
+    cprintf("\nbuddyFreePages=%d, buddyLargestOrder=%d, buddyBlocksInUse=%d\n",
+            buddyStats.freePages, buddyStats.largestOrder, buddyStats.blocksInUse);
+    struct slabstats slabStats;
+    for(int i = 0; getSlabStats(i, &slabStats) == 0; i++){
+      cprintf("slab %s: objSize=%d, objsPerSlab=%d, slabs=%d, objsInUse=%d, cachedObjs=%d, allocs=%d, frees=%d, refills=%d, flushes=%d\n",
+              slabStats.name, slabStats.objSize, slabStats.objsPerSlab, slabStats.slabs,
+              slabStats.objsInUse, slabStats.cachedObjs, slabStats.allocs, slabStats.frees,
+              slabStats.refills, slabStats.flushes);
+    }
+    cprintf("tlbShootdowns=%d, tlbShootdownIpis=%d\n", tlbStats.shootdowns, tlbStats.ipis);
+    cprintf("zswapStoredPages=%d, zswapStoredBytes=%d, zswapPoolPages=%d\n",
+            zswapStats.storedPages, zswapStats.storedBytes, zswapStats.poolPages);
+    cprintf("zswapStores=%d, zswapLoads=%d, zswapRejects=%d, zswapPoolFull=%d, zswapWriteBacks=%d\n",
+            zswapStats.stores, zswapStats.loads, zswapStats.rejects,
+            zswapStats.poolFull, zswapStats.writeBacks);
     cprintf("\n");
 }
 
 void resetAccessBit(struct proc *p){
+    struct tlbbatch batch = { p->pgdir, 0 };
+
     for(int i = 0; i < p->sz; i+= 4096){
         pte_t* pte = walkpgdir(p->pgdir, (char*)i, 0);
 
-        if(pte){
+        // a cached translation would keep the cpu from setting PTE_A again
+        if(pte && (*pte & PTE_A)){
             *pte = *pte & ~PTE_A;
+            addToTlbBatch(&batch, i);
         }
     }
+
+    endTlbBatch(&batch);
+}
+
+// shift PTE_A of every resident page into its age counter and clear it.
+// Called from the timer interrupt every agingInterval ticks.
+void updatePageAges(struct proc *p){
+    struct tlbbatch batch = { p->pgdir, 0 };
+    int vpn = p->fifoHead;
+    for(int i = 0; i < p->noOfPhysicalPages; i++, vpn = getPageInfoOfVpn(p, vpn)->next){
+      pte_t* pte = walkpgdir(p->pgdir, (char*)(vpn * PGSIZE), 0);
+
+      struct pageinfo *page = getPageInfoOfVpn(p, vpn);
+
+      page->age >>= 1;
+      if(*pte & PTE_A){
+        page->age |= 0x80;
+        *pte = *pte & ~PTE_A;
+        // the cached translation must be dropped so the cpu sets PTE_A again
+        addToTlbBatch(&batch, vpn * PGSIZE);
+      }
+    }
+
+    endTlbBatch(&batch);
 }
 
 
@@ -0,0 +1,315 @@
+// Compressed swap pool. A page written to a swap slot is first compressed
+// into a pool of kalloc'd pages, and only goes to the raw swap area when
+// it does not compress well or when the pool has no room for it. The pool
+// is indexed by swap slot: a stored page keeps its slot, and with it its
+// blocks on disk, so the slot allocator and its reference counts work
+// unchanged and a full pool can write its oldest pages back to their slots.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+
+/*------------------------- my changes starts -----------------------------*/
+
+#define ZSWAP_CHUNK_SIZE 128                          // pool allocation unit
+#define ZSWAP_CHUNKS     (PGSIZE / ZSWAP_CHUNK_SIZE)  // one bit each in a uint
+#define ZSWAP_MAX_SIZE   (PGSIZE * 3 / 4)  // pages that compress worse go to disk
+#define ZSWAP_HASH_BITS  10
+
+// LZF-style codec. A control byte below 32 is followed by that many
+// literals plus one; otherwise its top 3 bits are the match length minus 2
+// (7 means one more length byte follows) and its low 5 bits with the next
+// byte are the distance back to the match minus 1.
+#define LZ_MAX_LITERALS 32
+#define LZ_MAX_OFFSET   (1 << 13)
+#define LZ_MAX_MATCH    (7 + 255 + 2)
+
+struct zentry {
+  ushort size;  // compressed bytes, 0 if the slot is not in the pool
+  uchar page;   // pool page holding it
+  uchar chunk;  // its first chunk in that page
+  uint seq;     // store order, the oldest page is written back first
+};
+
+struct {
+  struct spinlock lock;
+  char *pages[ZSWAP_POOL_PAGES];
+  uint chunkMap[ZSWAP_POOL_PAGES];    // a set bit means the chunk is used
+  struct zentry entries[MAX_SWAP_SLOTS];
+  uint seq;
+  ushort htab[1 << ZSWAP_HASH_BITS];  // compressor state, used under lock
+  uchar buf[ZSWAP_MAX_SIZE];          // output of the compressor
+} zswap;
+
+struct zswapstats zswapStats;
+
+void
+zswapinit(void)
+{
+  initlock(&zswap.lock, "zswap");
+}
+
+static uint
+lzHash(const uchar *p)
+{
+  return ((p[0] << 16 | p[1] << 8 | p[2]) * 2654435761U) >> (32 - ZSWAP_HASH_BITS);
+}
+
+// append the literals in[start..end) to out, 0 if they do not fit
+static int
+lzLiterals(const uchar *in, uint start, uint end, uchar *out, uint *op, uint outLen)
+{
+  while(start < end){
+    uint n = end - start < LZ_MAX_LITERALS ? end - start : LZ_MAX_LITERALS;
+
+    if(*op + 1 + n > outLen)
+      return 0;
+    out[(*op)++] = n - 1;
+    memmove(out + *op, in + start, n);
+    *op += n;
+    start += n;
+  }
+  return 1;
+}
+
+// compress inLen bytes into at most outLen bytes, 0 if they do not fit
+static uint
+lzCompress(const uchar *in, uint inLen, uchar *out, uint outLen)
+{
+  uint ip = 0, op = 0, lit = 0;
+
+  memset(zswap.htab, 0, sizeof(zswap.htab));
+
+  while(ip + 2 < inLen){
+    uint h = lzHash(in + ip);
+    uint ref = zswap.htab[h];
+
+    // the table keeps positions plus one, 0 is an empty entry
+    zswap.htab[h] = ip + 1;
+
+    if(ref == 0 || ip - (ref - 1) > LZ_MAX_OFFSET ||
+       memcmp(in + ref - 1, in + ip, 3) != 0){
+      ip++;
+      continue;
+    }
+
+    uint off = ip - ref;
+    uint len = 3;
+    uint maxLen = inLen - ip < LZ_MAX_MATCH ? inLen - ip : LZ_MAX_MATCH;
+
+    while(len < maxLen && in[ref - 1 + len] == in[ip + len])
+      len++;
+
+    if(!lzLiterals(in, lit, ip, out, &op, outLen) || op + 3 > outLen)
+      return 0;
+
+    if(len - 2 < 7){
+      out[op++] = ((len - 2) << 5) | (off >> 8);
+    } else {
+      out[op++] = (7 << 5) | (off >> 8);
+      out[op++] = len - 2 - 7;
+    }
+    out[op++] = off & 0xff;
+
+    ip += len;
+    lit = ip;
+  }
+
+  if(!lzLiterals(in, lit, inLen, out, &op, outLen))
+    return 0;
+
+  return op;
+}
+
+// decompress into exactly outLen bytes, -1 if the input is corrupt
+static int
+lzDecompress(const uchar *in, uint inLen, uchar *out, uint outLen)
+{
+  uint ip = 0, op = 0;
+
+  while(ip < inLen){
+    uint c = in[ip++];
+
+    if(c < LZ_MAX_LITERALS){
+      if(ip + c + 1 > inLen || op + c + 1 > outLen)
+        return -1;
+      memmove(out + op, in + ip, c + 1);
+      ip += c + 1;
+      op += c + 1;
+      continue;
+    }
+
+    uint len = c >> 5;
+    if(len == 7){
+      if(ip >= inLen)
+        return -1;
+      len += in[ip++];
+    }
+    len += 2;
+
+    if(ip >= inLen)
+      return -1;
+    uint off = ((c & 0x1f) << 8 | in[ip++]) + 1;
+
+    if(off > op || op + len > outLen)
+      return -1;
+    // byte by byte, a match may overlap the bytes it produces
+    for(uint i = 0; i < len; i++, op++)
+      out[op] = out[op - off];
+  }
+
+  return op == outLen ? 0 : -1;
+}
+
+// take n consecutive chunks of one pool page, the page is allocated when
+// no page in use has room. Returns page << 8 | chunk, -1 if the pool is full.
+static int
+allocChunks(int n)
+{
+  uint mask = n == ZSWAP_CHUNKS ? ~0U : (1U << n) - 1;
+
+  for(int i = 0; i < ZSWAP_POOL_PAGES; i++){
+    if(zswap.pages[i] == 0)
+      continue;
+    for(int chunk = 0; chunk + n <= ZSWAP_CHUNKS; chunk++){
+      if((zswap.chunkMap[i] & (mask << chunk)) == 0){
+        zswap.chunkMap[i] |= mask << chunk;
+        return i << 8 | chunk;
+      }
+    }
+  }
+
+  for(int i = 0; i < ZSWAP_POOL_PAGES; i++){
+    if(zswap.pages[i] == 0){
+      // the pool does not take the last free frames
+      if(getNoOfFreePages() < GLOBAL_FREE_PAGES_LOW ||
+         (zswap.pages[i] = kalloc()) == 0)
+        return -1;
+      zswapStats.poolPages++;
+      zswap.chunkMap[i] = mask;
+      return i << 8;
+    }
+  }
+
+  return -1;
+}
+
+static int
+noOfChunks(uint size)
+{
+  return (size + ZSWAP_CHUNK_SIZE - 1) / ZSWAP_CHUNK_SIZE;
+}
+
+// drop the page of slot from the pool, the pool page is given back to
+// kalloc when it has nothing left. The caller holds zswap.lock.
+static void
+freeEntry(int slot)
+{
+  struct zentry *e = &zswap.entries[slot];
+  int n = noOfChunks(e->size);
+
+  if(e->size == 0)
+    return;
+
+  zswap.chunkMap[e->page] &= ~((n == ZSWAP_CHUNKS ? ~0U : (1U << n) - 1) << e->chunk);
+  if(zswap.chunkMap[e->page] == 0){
+    kfree(zswap.pages[e->page]);
+    zswap.pages[e->page] = 0;
+    zswapStats.poolPages--;
+  }
+
+  zswapStats.storedPages--;
+  zswapStats.storedBytes -= e->size;
+  e->size = 0;
+}
+
+// Keep the page of slot in the pool. Returns 0 if it is stored, -1 if it
+// does not compress well enough and -2 if the pool has no room for it; in
+// both cases the page has to be written to disk. Whatever the pool held
+// for the slot before is dropped.
+int
+zswapStore(int slot, char *page)
+{
+  int size, at;
+
+  acquire(&zswap.lock);
+  freeEntry(slot);
+  zswapStats.stores++;
+
+  if((size = lzCompress((uchar*)page, PGSIZE, zswap.buf, ZSWAP_MAX_SIZE)) == 0){
+    zswapStats.rejects++;
+    release(&zswap.lock);
+    return -1;
+  }
+
+  if((at = allocChunks(noOfChunks(size))) == -1){
+    zswapStats.poolFull++;
+    release(&zswap.lock);
+    return -2;
+  }
+
+  struct zentry *e = &zswap.entries[slot];
+  e->size = size;
+  e->page = at >> 8;
+  e->chunk = at & 0xff;
+  e->seq = zswap.seq++;
+  memmove(zswap.pages[e->page] + e->chunk * ZSWAP_CHUNK_SIZE, zswap.buf, size);
+
+  zswapStats.storedPages++;
+  zswapStats.storedBytes += size;
+  release(&zswap.lock);
+
+  return 0;
+}
+
+// decompress the page of slot into page, -1 if the pool does not hold it
+int
+zswapLoad(int slot, char *page)
+{
+  struct zentry *e = &zswap.entries[slot];
+  int r = -1;
+
+  acquire(&zswap.lock);
+  if(e->size != 0){
+    r = lzDecompress((uchar*)zswap.pages[e->page] + e->chunk * ZSWAP_CHUNK_SIZE,
+                     e->size, (uchar*)page, PGSIZE);
+    if(r == -1)
+      panic("zswapLoad: corrupt page");
+  }
+  release(&zswap.lock);
+
+  return r;
+}
+
+// the slot is freed or holds a new page that is written to disk
+void
+zswapInvalidate(int slot)
+{
+  acquire(&zswap.lock);
+  freeEntry(slot);
+  release(&zswap.lock);
+}
+
+// slot of the page stored longest ago, -1 if the pool is empty
+int
+zswapOldestSlot(void)
+{
+  int oldest = -1;
+
+  acquire(&zswap.lock);
+  for(int slot = 0; slot < MAX_SWAP_SLOTS; slot++){
+    if(zswap.entries[slot].size != 0 &&
+       (oldest == -1 || zswap.seq - zswap.entries[slot].seq >
+                        zswap.seq - zswap.entries[oldest].seq)){
+      oldest = slot;
+    }
+  }
+  release(&zswap.lock);
+
+  return oldest;
+}
+
+/*------------------------- my changes ends -----------------------------*/